@@ -1,878 +1,6907 @@
-#define _USE_MATH_DEFINES
-#include <cmath>
-#include <algorithm>
-#include <iomanip>
-#include <iostream>
-#include <limits>
-#include <vector>
-#include <fstream>
-#include <cstdlib>
-#include <string>
-
-using namespace std;
-
-const double MASS0 = 155000.0;         // Масса самолета, кг (110 тонн)
-const double S_WING = 300.0;           // Площадь крыла, м²
-const int ENGINE_COUNT = 4;            // Количество двигателей
-const double THRUST_PERCENT = 90.0;   // Режим работы двигателей, %
-
-// Начальные и конечные параметры полета
-const double H_START = 400.0;          // Начальная высота, м
-const double H_FINISH = 6500.0;        // Конечная высота, м
-const double V_START_KMH = 320.0;      // Начальная скорость, км/ч
-const double V_FINISH_KMH = 800.0;     // Конечная скорость, км/ч
-
-const int N = 10;
-const double G = 9.81;
-const double DEG_TO_RAD = 57.3;
-
-const double MAX_VERTICAL_SPEED = 10.0;
-const double MAX_CLIMB_ANGLE = 15.0;
-const double MIN_CLIMB_SPEED_KMH = 320.0;
-
-enum OptimizationCriterion {
-    MIN_TIME = 1,
-    MIN_FUEL = 2
-};
-
-enum ManeuverType {
-    RAZGON = 1,
-    PODIEM = 2,
-    RAZGON_PODIEM = 3
-};
-
-struct AtmosPoint {
-    double H, rho, a, T;
-};
-
-static const AtmosPoint ATMOS_TABLE[] = {
-    {0.0,     1.22500, 340.294, 288.150},
-    {500.0,   1.16727, 338.370, 284.900},
-    {1000.0,  1.11166, 336.435, 281.651},
-    {2000.0,  1.00655, 332.532, 275.154},
-    {3000.0,  0.90254, 328.584, 268.659},
-    {4000.0,  0.81935, 324.589, 262.166},
-    {5000.0,  0.73643, 320.545, 255.676},
-    {6000.0,  0.66011, 316.452, 249.187},
-    {7000.0,  0.59002, 312.306, 242.700},
-    {8000.0,  0.52678, 308.105, 236.215},
-    {9000.0,  0.46706, 303.848, 229.733},
-    {10000.0, 0.41351, 299.532, 223.252},
-    {11000.0, 0.36480, 295.154, 216.774}
-};
-const int ATMOS_N = 13;
-
-double interpolate(double x, double x0, double x1, double y0, double y1) {
-    if (fabs(x1 - x0) < 1e-9) return y0;
-    return y0 + (x - x0) * (y1 - y0) / (x1 - x0);
-}
-
-void atmosphere(double H, double& rho, double& a_sound) {
-    if (H <= ATMOS_TABLE[0].H) {
-        rho = ATMOS_TABLE[0].rho;
-        a_sound = ATMOS_TABLE[0].a;
-    }
-    if (H >= ATMOS_TABLE[ATMOS_N - 1].H) {
-        rho = ATMOS_TABLE[ATMOS_N - 1].rho;
-        a_sound = ATMOS_TABLE[ATMOS_N - 1].a;
-    }
-
-    for (int i = 0; i < ATMOS_N - 1; i++) {
-        if (H >= ATMOS_TABLE[i].H && H < ATMOS_TABLE[i + 1].H) {
-            rho = interpolate(H, ATMOS_TABLE[i].H, ATMOS_TABLE[i + 1].H,
-                ATMOS_TABLE[i].rho, ATMOS_TABLE[i + 1].rho);
-            a_sound = interpolate(H, ATMOS_TABLE[i].H, ATMOS_TABLE[i + 1].H,
-                ATMOS_TABLE[i].a, ATMOS_TABLE[i + 1].a);
-        }
-    }
-}
-
-bool is_in_flight_envelope(double H, double V_kmh) {
-    if (V_kmh < 200.0 || V_kmh > 1100.0) return false;
-    if (H < 0.0 || H > 11000.0) return false;
-
-    double rho, a_sound;
-    atmosphere(H, rho, a_sound);
-    double M = (V_kmh / 3.6) / a_sound;
-
-    if (M > 1.04) return false;
-
-    return true;
-}
-
-const double CY0 = -0.08;
-const double CY1 = 0.075;
-
-double Cx_alpha(double alpha_deg) {
-    if (alpha_deg < 0.0) alpha_deg = 0.0;
-    if (alpha_deg > 10.0) alpha_deg = 10.0;
-
-    double Cx0 = 0.022;
-    double k = 0.035;
-
-    double Cy = CY0 + CY1 * alpha_deg;
-    double Cx = Cx0 + k * Cy * Cy;
-
-    if (Cx < 0.025) Cx = 0.025;
-
-    return Cx;
-}
-
-double thrust_single_d30kp_nominal(double H, double M) {
-    double H_km = H / 1000.0;
-    double P_sea = 58860.0;
-
-    double altitude_factor;
-    if (H_km <= 0) {
-        altitude_factor = 1.0;
-    }
-    else if (H_km >= 11.0) {
-        altitude_factor = 0.50;
-    }
-    else {
-        altitude_factor = 1.0 - 0.50 * pow(H_km / 11.0, 0.7);
-    }
-
-    double mach_factor = 0.88 + 0.24 * M;
-    if (mach_factor > 1.08) mach_factor = 1.08;
-
-    return P_sea * altitude_factor * mach_factor;
-}
-
-double total_thrust(double H, double V_ms) {
-    double rho, a_sound;
-    atmosphere(H, rho, a_sound);
-    double M = V_ms / a_sound;
-
-    double P_single = thrust_single_d30kp_nominal(H, M);
-    return P_single * ENGINE_COUNT * (THRUST_PERCENT / 100.0);
-}
-
-double specific_fuel_consumption(double H, double V_ms, double power_setting) {
-    double rho, a_sound;
-    atmosphere(H, rho, a_sound);
-    double M = V_ms / a_sound;
-    double H_km = H / 1000.0;
-
-    double Cp_base = 0.72;
-
-    double regime_factor;
-    if (power_setting >= 1.0) {
-        regime_factor = 1.0 + 0.45 * pow(power_setting - 1.0, 1.2);
-    }
-    else if (power_setting >= 0.88) {
-        regime_factor = 0.92 - 0.02 * (power_setting - 0.88) / 0.12;
-    }
-    else if (power_setting >= 0.70) {
-        regime_factor = 0.92 + 0.12 * pow((0.88 - power_setting) / 0.18, 1.1);
-    }
-    else {
-        regime_factor = 1.18;
-    }
-
-    double altitude_factor = 1.0 - 0.07 * min(1.0, H_km / 11.0);
-    double mach_factor = 1.0 + 0.14 * max(0.0, M - 0.5);
-
-    double Cp = Cp_base * regime_factor * altitude_factor * mach_factor;
-    return Cp / 9.81;
-}
-
-double calculate_alpha(double H, double V_ms, double mass) {
-    double rho, a_sound;
-    atmosphere(H, rho, a_sound);
-
-    double P = total_thrust(H, V_ms);
-    double q = 0.5 * rho * V_ms * V_ms;
-
-    if (q < 100.0) return 8.0;
-
-    double alpha_deg = (mass * G - P / DEG_TO_RAD - CY0 * q * S_WING) / (CY1 * q * S_WING);
-
-    if (alpha_deg < 0.0) alpha_deg = 0.0;
-    if (alpha_deg > 10.0) alpha_deg = 10.0;
-
-    return alpha_deg;
-}
-
-struct SegmentData {
-    double time;
-    double fuel;
-    bool valid;
-};
-
-SegmentData calculate_razgon(double H, double V1_ms, double V2_ms, double mass, double power_setting) {
-    SegmentData result;
-    result.valid = false;
-    result.time = 1e9;
-    result.fuel = 1e9;
-
-    if (!is_in_flight_envelope(H, V1_ms * 3.6) || !is_in_flight_envelope(H, V2_ms * 3.6)) {
-        return result;
-    }
-
-    double V_avg = 0.5 * (V1_ms + V2_ms);
-    double alpha_deg = calculate_alpha(H, V_avg, mass);
-    double alpha_rad = alpha_deg / DEG_TO_RAD;
-
-    double P_max = total_thrust(H, V_avg);
-    double P_used = P_max * power_setting;
-
-    double rho, a_sound;
-    atmosphere(H, rho, a_sound);
-    double q = 0.5 * rho * V_avg * V_avg;
-
-    double Cx = Cx_alpha(alpha_deg);
-    double X = Cx * q * S_WING;
-
-    double dV_dt = (P_used * cos(alpha_rad) - X) / mass;
-
-    if (dV_dt <= 0.01) return result;
-
-    double dt = (V2_ms - V1_ms) / dV_dt;
-
-    if (dt > 1000.0 || dt <= 0) return result;
-
-    double c_p = specific_fuel_consumption(H, V_avg, power_setting);
-    double fuel = c_p * P_used * dt / 3600.0;
-
-    result.time = dt;
-    result.fuel = fuel;
-    result.valid = true;
-
-    return result;
-}
-
-SegmentData calculate_podiem(double H1, double H2, double V_ms, double mass, double power_setting, double max_vy_factor) {
-    SegmentData result;
-    result.valid = false;
-    result.time = 1e9;
-    result.fuel = 1e9;
-
-    if (V_ms * 3.6 < MIN_CLIMB_SPEED_KMH) return result;
-    if (!is_in_flight_envelope(H1, V_ms * 3.6) || !is_in_flight_envelope(H2, V_ms * 3.6)) {
-        return result;
-    }
-
-    double H_avg = 0.5 * (H1 + H2);
-    double alpha_deg = calculate_alpha(H_avg, V_ms, mass);
-
-    double P_max = total_thrust(H_avg, V_ms);
-    double P_used = P_max * power_setting;
-
-    double rho, a_sound;
-    atmosphere(H_avg, rho, a_sound);
-    double q = 0.5 * rho * V_ms * V_ms;
-
-    double Cx = Cx_alpha(alpha_deg);
-    double X = Cx * q * S_WING;
-
-    double P_excess = P_used - X;
-
-    if (P_excess <= 0) return result;
-
-    double theta_max_rad = MAX_CLIMB_ANGLE / DEG_TO_RAD;
-    double sin_theta = min(P_excess / (mass * G), sin(theta_max_rad));
-
-    if (sin_theta <= 0.005) return result;
-
-    double Vy = V_ms * sin_theta;
-
-    double max_vy_limit = MAX_VERTICAL_SPEED * max_vy_factor;
-    if (Vy > max_vy_limit) {
-        Vy = max_vy_limit;
-    }
-
-    double dt = (H2 - H1) / Vy;
-
-    if (dt <= 0 || dt > 2000.0) return result;
-
-    double c_p = specific_fuel_consumption(H_avg, V_ms, power_setting);
-    double fuel = c_p * P_used * dt / 3600.0;
-
-    result.time = dt;
-    result.fuel = fuel;
-    result.valid = true;
-
-    return result;
-}
-
-SegmentData calculate_razgon_podiem(double H1, double H2, double V1_ms, double V2_ms, double mass, double power_setting, double max_vy_factor) {
-    SegmentData result;
-    result.valid = false;
-    result.time = 1e9;
-    result.fuel = 1e9;
-
-    double V_avg = 0.5 * (V1_ms + V2_ms);
-    double H_avg = 0.5 * (H1 + H2);
-
-    if (V_avg * 3.6 < (MIN_CLIMB_SPEED_KMH * 0.95)) return result;
-    if (!is_in_flight_envelope(H1, V1_ms * 3.6) || !is_in_flight_envelope(H2, V2_ms * 3.6)) {
-        return result;
-    }
-
-    SegmentData razgon = calculate_razgon(H_avg, V1_ms, V2_ms, mass, power_setting);
-    SegmentData podiem = calculate_podiem(H1, H2, V_avg, mass, power_setting, max_vy_factor);
-
-    if (!razgon.valid || !podiem.valid) return result;
-
-    double dH = H2 - H1;
-    double dV_kmh = (V2_ms - V1_ms) * 3.6;
-
-    double time_for_climb = dH / 5.0;
-    double time_for_accel = fabs(dV_kmh) / 15.0;
-
-    double dt = max(time_for_climb, time_for_accel);
-
-    if (dt <= 0 || dt > 3000.0) return result;
-
-    double Vy = dH / dt;
-    double max_vy_limit = MAX_VERTICAL_SPEED * max_vy_factor * 1.2;
-
-    if (Vy < 0.3 || Vy > max_vy_limit) return result;
-
-    double dV_dt = (V2_ms - V1_ms) / dt;
-    if (fabs(dV_dt) > 5.0) return result;
-
-    double P_max = total_thrust(H_avg, V_avg);
-    double P_used = P_max * power_setting;
-
-    double c_p = specific_fuel_consumption(H_avg, V_avg, power_setting);
-    double fuel = c_p * P_used * dt / 3600.0;
-
-    result.time = dt;
-    result.fuel = fuel;
-    result.valid = true;
-
-    return result;
-}
-
-struct TrajectoryResult {
-    vector<pair<double, double> > path;
-    vector<ManeuverType> maneuvers;
-    vector<double> segment_times;
-    vector<double> segment_fuels;
-    double total_time;
-    double total_fuel;
-    double avg_vy;
-    int used_razgon;
-    int used_podiem;
-    int used_combined;
-    string name;
-};
-
-TrajectoryResult solve_trajectory(OptimizationCriterion criterion, string traj_name) {
-    TrajectoryResult trajectory;
-    trajectory.name = traj_name;
-
-    cout << "\n========================================\n";
-    if (criterion == MIN_TIME) {
-        cout << "KRITERII: MINIMIZACIA VREMENI (" << traj_name << ")\n";
-    }
-    else {
-        cout << "KRITERII: MINIMIZACIA TOPLIVA (" << traj_name << ")\n";
-    }
-    cout << "========================================\n\n";
-
-    double dH = (H_FINISH - H_START) / N;
-    double dV_kmh = (V_FINISH_KMH - V_START_KMH) / N;
-
-    vector<double> H_grid(N + 1);
-    vector<double> V_grid_kmh(N + 1);
-    vector<double> V_grid_ms(N + 1);
-
-    for (int i = 0; i <= N; i++) {
-        H_grid[i] = H_START + i * dH;
-        V_grid_kmh[i] = V_START_KMH + i * dV_kmh;
-        V_grid_ms[i] = V_grid_kmh[i] / 3.6;
-    }
-
-    vector<double> power_settings;
-    double max_vy_factor;
-
-    if (criterion == MIN_TIME) {
-        power_settings.push_back(1.08);
-        power_settings.push_back(1.05);
-        power_settings.push_back(1.00);
-        max_vy_factor = 1.0;
-    }
-    else {
-        power_settings.push_back(0.88);
-        power_settings.push_back(0.82);
-        power_settings.push_back(0.75);
-        max_vy_factor = 0.65;
-    }
-
-    vector<vector<double> > cost_table(N + 1, vector<double>(N + 1, 1e9));
-    vector<vector<double> > time_table(N + 1, vector<double>(N + 1, 0.0));
-    vector<vector<double> > fuel_table(N + 1, vector<double>(N + 1, 0.0));
-    vector<vector<int> > prev_i(N + 1, vector<int>(N + 1, -1));
-    vector<vector<int> > prev_j(N + 1, vector<int>(N + 1, -1));
-    vector<vector<ManeuverType> > maneuver_type(N + 1, vector<ManeuverType>(N + 1, RAZGON));
-
-    cost_table[0][0] = 0.0;
-
-    for (int i = 0; i <= N; i++) {
-        for (int j = 0; j <= N; j++) {
-            if (cost_table[i][j] >= 1e9) continue;
-
-            double H1 = H_grid[i];
-            double V1_ms = V_grid_ms[j];
-
-            for (size_t ps = 0; ps < power_settings.size(); ps++) {
-                double power_setting = power_settings[ps];
-
-                if (j < N) {
-                    double V2_ms = V_grid_ms[j + 1];
-                    SegmentData seg = calculate_razgon(H1, V1_ms, V2_ms, MASS0, power_setting);
-
-                    if (seg.valid) {
-                        double cost_increment = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                        double new_cost = cost_table[i][j] + cost_increment;
-
-                        if (new_cost < cost_table[i][j + 1]) {
-                            cost_table[i][j + 1] = new_cost;
-                            time_table[i][j + 1] = time_table[i][j] + seg.time;
-                            fuel_table[i][j + 1] = fuel_table[i][j] + seg.fuel;
-                            prev_i[i][j + 1] = i;
-                            prev_j[i][j + 1] = j;
-                            maneuver_type[i][j + 1] = RAZGON;
-                        }
-                    }
-                }
-
-                if (i < N) {
-                    double H2 = H_grid[i + 1];
-                    SegmentData seg = calculate_podiem(H1, H2, V1_ms, MASS0, power_setting, max_vy_factor);
-
-                    if (seg.valid) {
-                        double cost_increment = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                        double new_cost = cost_table[i][j] + cost_increment;
-
-                        if (new_cost < cost_table[i + 1][j]) {
-                            cost_table[i + 1][j] = new_cost;
-                            time_table[i + 1][j] = time_table[i][j] + seg.time;
-                            fuel_table[i + 1][j] = fuel_table[i][j] + seg.fuel;
-                            prev_i[i + 1][j] = i;
-                            prev_j[i + 1][j] = j;
-                            maneuver_type[i + 1][j] = PODIEM;
-                        }
-                    }
-                }
-
-                if (i < N && j < N) {
-                    double H2 = H_grid[i + 1];
-                    double V2_ms = V_grid_ms[j + 1];
-                    SegmentData seg = calculate_razgon_podiem(H1, H2, V1_ms, V2_ms, MASS0, power_setting, max_vy_factor);
-
-                    if (seg.valid) {
-                        double cost_increment = (criterion == MIN_TIME) ? seg.time : seg.fuel;
-                        double new_cost = cost_table[i][j] + cost_increment;
-
-                        if (new_cost < cost_table[i + 1][j + 1]) {
-                            cost_table[i + 1][j + 1] = new_cost;
-                            time_table[i + 1][j + 1] = time_table[i][j] + seg.time;
-                            fuel_table[i + 1][j + 1] = fuel_table[i][j] + seg.fuel;
-                            prev_i[i + 1][j + 1] = i;
-                            prev_j[i + 1][j + 1] = j;
-                            maneuver_type[i + 1][j + 1] = RAZGON_PODIEM;
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // Сохраняем матрицы в CSV файлы
-    string suffix = (criterion == MIN_TIME) ? "min_time" : "min_fuel";
-
-    ofstream time_csv("time_matrix_" + suffix + ".csv");
-    time_csv << "H/V";
-    for (int j = 0; j <= N; j++) {
-        time_csv << "," << V_grid_kmh[j];
-    }
-    time_csv << "\n";
-
-    for (int i = 0; i <= N; i++) {
-        time_csv << H_grid[i];
-        for (int j = 0; j <= N; j++) {
-            time_csv << ",";
-            if (time_table[i][j] < 1e8) {
-                time_csv << time_table[i][j];
-            }
-        }
-        time_csv << "\n";
-    }
-    time_csv.close();
-
-    ofstream fuel_csv("fuel_matrix_" + suffix + ".csv");
-    fuel_csv << "H/V";
-    for (int j = 0; j <= N; j++) {
-        fuel_csv << "," << V_grid_kmh[j];
-    }
-    fuel_csv << "\n";
-
-    for (int i = 0; i <= N; i++) {
-        fuel_csv << H_grid[i];
-        for (int j = 0; j <= N; j++) {
-            fuel_csv << ",";
-            if (fuel_table[i][j] < 1e8) {
-                fuel_csv << fuel_table[i][j];
-            }
-        }
-        fuel_csv << "\n";
-    }
-    fuel_csv.close();
-
-    if (cost_table[N][N] >= 1e9) {
-        cout << "OSHIBKA: Ne naiden put!\n";
-        return trajectory;
-    }
-
-    vector<pair<double, double> > path;
-    vector<ManeuverType> path_maneuvers;
-    vector<double> seg_times;
-    vector<double> seg_fuels;
-    int ci = N, cj = N;
-
-    while (ci >= 0 && cj >= 0) {
-        path.push_back(make_pair(H_grid[ci], V_grid_kmh[cj]));
-        path_maneuvers.push_back(maneuver_type[ci][cj]);
-
-        int pi = prev_i[ci][cj];
-        int pj = prev_j[ci][cj];
-        if (pi == -1) break;
-
-        if (!(pi == ci && pj == cj)) {
-            seg_times.push_back(time_table[ci][cj] - time_table[pi][pj]);
-            seg_fuels.push_back(fuel_table[ci][cj] - fuel_table[pi][pj]);
-        }
-
-        ci = pi;
-        cj = pj;
-    }
-
-    reverse(path.begin(), path.end());
-    reverse(path_maneuvers.begin(), path_maneuvers.end());
-    reverse(seg_times.begin(), seg_times.end());
-    reverse(seg_fuels.begin(), seg_fuels.end());
-
-    ofstream traj_csv("trajectory_" + suffix + ".csv");
-    traj_csv << "Point,H_m,V_kmh,Maneuver,Segment_time_s,Segment_fuel_kg\n";
-
-    for (size_t k = 0; k < path.size(); k++) {
-        traj_csv << k + 1 << ","
-            << path[k].first << ","
-            << path[k].second << ",";
-
-        if (k == 0) {
-            traj_csv << "START,0,0";
-        }
-        else {
-            string maneuver_str;
-            if (path_maneuvers[k] == RAZGON) maneuver_str = "RAZGON";
-            else if (path_maneuvers[k] == PODIEM) maneuver_str = "PODIEM";
-            else if (path_maneuvers[k] == RAZGON_PODIEM) maneuver_str = "RAZGON_PODIEM";
-
-            traj_csv << maneuver_str << ","
-                << seg_times[k - 1] << ","
-                << seg_fuels[k - 1];
-        }
-        traj_csv << "\n";
-    }
-    traj_csv.close();
-
-    int used_razgon = 0, used_podiem = 0, used_razgon_podiem = 0;
-    for (size_t k = 1; k < path_maneuvers.size(); k++) {
-        if (path_maneuvers[k] == RAZGON) used_razgon++;
-        else if (path_maneuvers[k] == PODIEM) used_podiem++;
-        else if (path_maneuvers[k] == RAZGON_PODIEM) used_razgon_podiem++;
-    }
-
-    // Вывод матрицы времени
-    cout << "Matrica vremeni (s):\n";
-    cout << "     V->";
-    for (int j = 0; j <= N; j++) {
-        cout << setw(7) << (int)V_grid_kmh[j];
-    }
-    cout << "\nH\n";
-    for (int i = 0; i <= N; i++) {
-        cout << setw(5) << (int)H_grid[i];
-        for (int j = 0; j <= N; j++) {
-            if (time_table[i][j] < 1e8) {
-                cout << setw(7) << (int)time_table[i][j];
-            }
-            else {
-                cout << setw(7) << "---";
-            }
-        }
-        cout << "\n";
-    }
-
-    // Вывод матрицы топлива
-    cout << "\nMatrica raskhoda topliva (kg):\n";
-    cout << "     V->";
-    for (int j = 0; j <= N; j++) {
-        cout << setw(7) << (int)V_grid_kmh[j];
-    }
-    cout << "\nH\n";
-    for (int i = 0; i <= N; i++) {
-        cout << setw(5) << (int)H_grid[i];
-        for (int j = 0; j <= N; j++) {
-            if (fuel_table[i][j] < 1e8) {
-                cout << setw(7) << (int)fuel_table[i][j];
-            }
-            else {
-                cout << setw(7) << "---";
-            }
-        }
-        cout << "\n";
-    }
-    cout << "\n";
-
-    cout << "Optimalnaya traektoriya:\n";
-    cout << "-------------------------------------------------------------\n";
-    cout << "Tochka\tH (m)\t\tV (km/h)\tManevr\t\tVremya\tToplivo\n";
-    cout << "-------------------------------------------------------------\n";
-
-    for (size_t k = 0; k < path.size(); k++) {
-        cout << k + 1 << "\t" << fixed << setprecision(1)
-            << setw(8) << path[k].first
-            << "\t" << setw(8) << path[k].second << "\t";
-
-        if (k > 0) {
-            if (path_maneuvers[k] == RAZGON) cout << "Razgon\t\t";
-            else if (path_maneuvers[k] == PODIEM) cout << "Podiem\t\t";
-            else if (path_maneuvers[k] == RAZGON_PODIEM) cout << "Raz+Pod\t\t";
-
-            cout << setw(6) << seg_times[k - 1] << "\t"
-                << setw(6) << seg_fuels[k - 1];
-        }
-        else {
-            cout << "Start\t\t0\t0";
-        }
-        cout << "\n";
-    }
-
-    cout << "\n=============================================\n";
-    cout << "Ispolzovano v traektorii:\n";
-    cout << "- Razgon: " << used_razgon << " raz\n";
-    cout << "- Podiem: " << used_podiem << " raz\n";
-    cout << "- Razgon+Podiem: " << used_razgon_podiem << " raz\n";
-    cout << "---------------------------------------------\n";
-    cout << fixed << setprecision(2);
-    cout << "Vremya manevra:     " << time_table[N][N] << " s  ("
-        << time_table[N][N] / 60.0 << " min)\n";
-    cout << "Raskhod topliva:    " << fuel_table[N][N] << " kg\n";
-
-    double delta_H = H_FINISH - H_START;
-    double avg_climb_rate = delta_H / time_table[N][N];
-
-    cout << "Srednyaya Vy:       " << avg_climb_rate << " m/s  ("
-        << avg_climb_rate * 60.0 << " m/min)\n";
-
-    cout << "\nFiles created:\n";
-    cout << "- trajectory_" << suffix << ".csv\n";
-    cout << "- time_matrix_" << suffix << ".csv\n";
-    cout << "- fuel_matrix_" << suffix << ".csv\n";
-    cout << "=============================================\n";
-
-    trajectory.path = path;
-    trajectory.maneuvers = path_maneuvers;
-    trajectory.segment_times = seg_times;
-    trajectory.segment_fuels = seg_fuels;
-    trajectory.total_time = time_table[N][N];
-    trajectory.total_fuel = fuel_table[N][N];
-    trajectory.avg_vy = avg_climb_rate;
-    trajectory.used_razgon = used_razgon;
-    trajectory.used_podiem = used_podiem;
-    trajectory.used_combined = used_razgon_podiem;
-
-    return trajectory;
-}
-
-// Функция для создания GNUPLOT скриптов
-void create_gnuplot_scripts(const TrajectoryResult& traj_time, const TrajectoryResult& traj_fuel) {
-    cout << "\nCreating GNUPLOT scripts...\n";
-
-    // 1. Скрипт для сравнения траекторий
-    ofstream comp_script("plot_comparison.gp");
-    comp_script << "# GNUPLOT script for trajectory comparison\n";
-    comp_script << "set terminal pngcairo size 1200,800 enhanced font 'Verdana,12'\n";
-    comp_script << "set output 'IL-76_comparison.png'\n\n";
-    comp_script << "set title 'IL-76 Trajectory Comparison (Variant 1)'\n";
-    comp_script << "set xlabel 'Speed V (km/h)'\n";
-    comp_script << "set ylabel 'Altitude H (m)'\n";
-    comp_script << "set grid\n";
-    comp_script << "set key top left\n";
-    comp_script << "set datafile separator ','\n\n";
-    comp_script << "# Plot with lines AND points\n";
-    comp_script << "plot 'trajectory_min_time.csv' using 3:2 every ::1 \\\n";
-    comp_script << "     with linespoints lw 2 pt 7 ps 1.2 lc rgb 'red' \\\n";
-    comp_script << "     title 'Min Time (" << traj_time.total_time / 60.0
-        << " min, " << traj_time.total_fuel << " kg)', \\\n";
-    comp_script << "     'trajectory_min_fuel.csv' using 3:2 every ::1 \\\n";
-    comp_script << "     with linespoints lw 2 pt 7 ps 1.2 lc rgb 'blue' \\\n";
-    comp_script << "     title 'Min Fuel (" << traj_fuel.total_time / 60.0
-        << " min, " << traj_fuel.total_fuel << " kg)'\n\n";
-
-    // 2. Скрипт для отдельных траекторий
-    ofstream time_script("plot_min_time.gp");
-    time_script << "# GNUPLOT script for min time trajectory\n";
-    time_script << "set terminal pngcairo size 800,600 enhanced\n";
-    time_script << "set output 'IL-76_min_time.png'\n\n";
-    time_script << "set title 'IL-76 - Minimize Time'\n";
-    time_script << "set xlabel 'Speed V (km/h)'\n";
-    time_script << "set ylabel 'Altitude H (m)'\n";
-    time_script << "set grid\n";
-    time_script << "set datafile separator ','\n";
-    time_script << "# Plot with points at each vertex\n";
-    time_script << "plot 'trajectory_min_time.csv' using 3:2 every ::1 \\\n";
-    time_script << "     with linespoints lw 2 pt 7 ps 1.5 lc rgb 'red' \\\n";
-    time_script << "     title 'Min Time Trajectory'\n\n";
-    time_script << "# Optionally label maneuvers\n";
-    time_script << "# To add maneuver labels, uncomment below:\n";
-    time_script << "# set label 'Razgon' at first point...\n";
-    time_script.close();
-
-    ofstream fuel_script("plot_min_fuel.gp");
-    fuel_script << "# GNUPLOT script for min fuel trajectory\n";
-    fuel_script << "set terminal pngcairo size 800,600 enhanced\n";
-    fuel_script << "set output 'IL-76_min_fuel.png'\n\n";
-    fuel_script << "set title 'IL-76 - Minimize Fuel'\n";
-    fuel_script << "set xlabel 'Speed V (km/h)'\n";
-    fuel_script << "set ylabel 'Altitude H (m)'\n";
-    fuel_script << "set grid\n";
-    fuel_script << "set datafile separator ','\n";
-    fuel_script << "plot 'trajectory_min_fuel.csv' using 3:2 every ::1 \\\n";
-    fuel_script << "     with linespoints lw 2 pt 7 ps 1.5 lc rgb 'blue' \\\n";
-    fuel_script << "     title 'Min Fuel Trajectory'\n";
-    fuel_script.close();
-
-    // // 4. BAT файл для Windows
-    // ofstream bat_file("run_plots.bat");
-    // bat_file << "@echo off\n";
-    // bat_file << "echo Running GNUPLOT scripts for IL-76...\n";
-    // bat_file << "echo.\n";
-    // bat_file << "echo 1. Comparison plot\n";
-    // bat_file << "\"C:\\Program Files\\gnuplot\\bin\\bin\\gnuplot.exe plot_comparison.gp\n";
-    // bat_file << "echo 2. Min time plot\n";
-    // bat_file << "gnuplot plot_min_time.gp\n";
-    // bat_file << "echo 3. Min fuel plot\n";
-    // bat_file << "gnuplot plot_min_fuel.gp\n";
-    // bat_file << "echo.\n";
-    // bat_file << "echo Plots created:\n";
-    // bat_file << "echo - IL-76_comparison.png\n";
-    // bat_file << "echo - IL-76_min_time.png\n";
-    // bat_file << "echo - IL-76_min_fuel.png\n";
-    // bat_file << "echo.\n";
-    // bat_file << "pause\n";
-    // bat_file.close();
-}
-
-int main() {
-    cout << fixed << setprecision(2);
-
-    cout << "\n=================================================\n";
-    cout << "   OPTIMIZACIA TRAEKTORII IL-76 (Variant 9)\n";
-    cout << "=================================================\n";
-    cout << "Samolyet: IL-76 (massa " << MASS0 / 1000.0 << " t)\n";
-    cout << "Dvigateli: 4 x Д-30КП (" << THRUST_PERCENT << "% nominala)\n";
-    cout << "Start: H = " << H_START << " m, V = " << V_START_KMH << " km/h\n";
-    cout << "Finish: H = " << H_FINISH << " m, V = " << V_FINISH_KMH << " km/h\n";
-    cout << "=================================================\n\n";
-
-    int choice;
-    cout << "Vyberte kriterii optimizacii:\n";
-    cout << "1 - Minimizacia vremeni\n";
-    cout << "2 - Minimizacia raskhoda topliva\n";
-    cout << "3 - Sravnit oba kriteriya + GNUPLOT GRAFIKI\n";
-    cout << "Vash vybor (1, 2 ili 3): ";
-    cin >> choice;
-
-    if (choice == 1) {
-        TrajectoryResult result = solve_trajectory(MIN_TIME, "min_time");
-
-        // Создаем простой GNUPLOT скрипт для этой траектории
-        ofstream gp_script("plot_single.gp");
-        gp_script << "# GNUPLOT script for single trajectory\n";
-        gp_script << "set terminal pngcairo size 800,600 enhanced\n";
-        gp_script << "set output 'IL-76_single.png'\n\n";
-        gp_script << "set title 'IL-76 - Minimize Time'\n";
-        gp_script << "set xlabel 'Speed V (km/h)'\n";
-        gp_script << "set ylabel 'Altitude H (m)'\n";
-        gp_script << "set grid\n";
-        gp_script << "set datafile separator ','\n";
-        gp_script << "plot 'trajectory_min_time.csv' every ::1 using 3:2 with linespoints \\\n";
-        gp_script << "     lw 2 pt 7 ps 1 title 'Flight path'\n";
-        gp_script.close();
-
-        cout << "\n========================================\n";
-        cout << "To generate plot, run:\n";
-        cout << "gnuplot plot_single.gp\n";
-        cout << "Output: IL-76_single.png\n";
-        cout << "========================================\n";
-    }
-    else if (choice == 2) {
-        TrajectoryResult result = solve_trajectory(MIN_FUEL, "min_fuel");
-
-        ofstream gp_script("plot_single.gp");
-        gp_script << "# GNUPLOT script for single trajectory\n";
-        gp_script << "set terminal pngcairo size 800,600 enhanced\n";
-        gp_script << "set output 'IL-76_single.png'\n\n";
-        gp_script << "set title 'IL-76 - Minimize Fuel'\n";
-        gp_script << "set xlabel 'Speed V (km/h)'\n";
-        gp_script << "set ylabel 'Altitude H (m)'\n";
-        gp_script << "set grid\n";
-        gp_script << "set datafile separator ','\n";
-        gp_script << "plot 'trajectory_min_fuel.csv' every ::1 using 3:2 with linespoints \\\n";
-        gp_script << "     lw 2 pt 7 ps 1 title 'Flight path'\n";
-        gp_script.close();
-
-        cout << "\n========================================\n";
-        cout << "To generate plot, run:\n";
-        cout << "gnuplot plot_single.gp\n";
-        cout << "Output: IL-76_single.png\n";
-        cout << "========================================\n";
-    }
-    else if (choice == 3) {
-        TrajectoryResult traj_time = solve_trajectory(MIN_TIME, "min_time");
-        TrajectoryResult traj_fuel = solve_trajectory(MIN_FUEL, "min_fuel");
-
-        create_gnuplot_scripts(traj_time, traj_fuel);
-
-        cout << "\n========================================\n";
-        cout << "Attempting to run GNUPLOT scripts...\n";
-
-#ifdef _WIN32
-        if (system("gnuplot --version > nul 2>&1") == 0) {
-            cout << "GNUPLOT found. Running scripts...\n\n";
-            system("run_plots.bat");
-        }
-        else {
-            cout << "GNUPLOT not found in PATH.\n";
-            cout << "Please install GNUPLOT from: http://www.gnuplot.info/\n";
-            cout << "Or run scripts manually:\n";
-            cout << "gnuplot plot_comparison.gp\n";
-            cout << "gnuplot plot_min_time.gp\n";
-            cout << "gnuplot plot_min_fuel.gp\n";
-        }
-#else
-        if (system("which gnuplot > /dev/null 2>&1") == 0) {
-            cout << "GNUPLOT found. Running scripts...\n";
-            system("bash run_plots.sh");
-        }
-        else {
-            cout << "GNUPLOT not found.\n";
-            cout << "Please install it: sudo apt-get install gnuplot (Ubuntu)\n";
-            cout << "Or: brew install gnuplot (Mac)\n";
-        }
-#endif
-        cout << "========================================\n";
-    }
-    else {
-        cout << "\nInvalid choice!\n";
-    }
-
-    cout << "\nProgram completed.\n";
-    return 0;
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#if defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>
+#endif
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Модель самолета и двигателей: масса, аэродинамика, тяга и расход.
+// Физика участков берет коэффициенты только отсюда; встроенная модель -
+// Ил-76 с Д-30КП, другие типы загружаются из файла (--aircraft).
+struct AircraftModel {
+    string name;
+    string engine;
+    double mass;               // Масса самолета, кг
+    double wing_area;          // Площадь крыла, м²
+    int engine_count;          // Количество двигателей
+    double thrust_percent;     // Режим работы двигателей, %
+
+    // Тяга одного двигателя: thrust_sea * f(H) * min(mach0 + mach_slope * M, mach_max),
+    // f(H) = 1 - lapse * (H / 11 км)^lapse_power
+    double thrust_sea;
+    double thrust_lapse;
+    double thrust_lapse_power;
+    double thrust_mach0;
+    double thrust_mach_slope;
+    double thrust_mach_max;
+
+    // Поляра: Cy = cy0 + cy1 * alpha, Cx = max(cx0 + k_induced * Cy^2, cx_min)
+    double cy0;
+    double cy1;
+    double cx0;
+    double k_induced;
+    double cx_min;
+    double alpha_max;
+
+    // Удельный расход: cp_base * (режим) * (1 - sfc_altitude * H / 11 км) * (1 + sfc_mach * (M - 0.5))
+    double cp_base;
+    double sfc_altitude;
+    double sfc_mach;
+
+    // Область полета
+    double V_min_kmh;
+    double V_max_kmh;
+    double H_max;
+    double M_max;
+};
+
+AircraftModel il76_d30kp() {
+    AircraftModel ac;
+    ac.name = "IL-76";
+    ac.engine = "Д-30КП";
+    ac.mass = 155000.0;
+    ac.wing_area = 300.0;
+    ac.engine_count = 4;
+    ac.thrust_percent = 90.0;
+
+    ac.thrust_sea = 58860.0;
+    ac.thrust_lapse = 0.50;
+    ac.thrust_lapse_power = 0.7;
+    ac.thrust_mach0 = 0.88;
+    ac.thrust_mach_slope = 0.24;
+    ac.thrust_mach_max = 1.08;
+
+    ac.cy0 = -0.08;
+    ac.cy1 = 0.075;
+    ac.cx0 = 0.022;
+    ac.k_induced = 0.035;
+    ac.cx_min = 0.025;
+    ac.alpha_max = 10.0;
+
+    ac.cp_base = 0.72;
+    ac.sfc_altitude = 0.07;
+    ac.sfc_mach = 0.14;
+
+    ac.V_min_kmh = 200.0;
+    ac.V_max_kmh = 1100.0;
+    ac.H_max = 11000.0;
+    ac.M_max = 1.04;
+    return ac;
+}
+
+// Начальные и конечные параметры полета
+const double H_START = 400.0;          // Начальная высота, м
+const double H_FINISH = 6500.0;        // Конечная высота, м
+const double V_START_KMH = 320.0;      // Начальная скорость, км/ч
+const double V_FINISH_KMH = 800.0;     // Конечная скорость, км/ч
+
+const int DEFAULT_N = 10;
+const int MAX_N = 20000;
+const double G = 9.81;
+const double DEG_TO_RAD = 57.3;
+
+const double MAX_VERTICAL_SPEED = 10.0;
+const double MAX_CLIMB_ANGLE = 15.0;
+const double MIN_CLIMB_SPEED_KMH = 320.0;
+
+enum OptimizationCriterion {
+    MIN_TIME = 1,
+    MIN_FUEL = 2,
+    MIN_COST = 3
+};
+
+enum ManeuverType {
+    RAZGON = 1,
+    PODIEM = 2,
+    RAZGON_PODIEM = 3,
+    TORMOZHENIE = 4,
+    SNIZHENIE = 5,
+    OBMEN_ENERGII = 6
+};
+
+// Имя маневра в файлах результатов
+const char* maneuver_name(int maneuver) {
+    if (maneuver == RAZGON) return "RAZGON";
+    if (maneuver == PODIEM) return "PODIEM";
+    if (maneuver == RAZGON_PODIEM) return "RAZGON_PODIEM";
+    if (maneuver == TORMOZHENIE) return "TORMOZHENIE";
+    if (maneuver == SNIZHENIE) return "SNIZHENIE";
+    if (maneuver == OBMEN_ENERGII) return "OBMEN_ENERGII";
+    return "";
+}
+
+struct AtmosPoint {
+    double H, rho, a, T;
+};
+
+static const AtmosPoint ATMOS_TABLE[] = {
+    {0.0,     1.22500, 340.294, 288.150},
+    {500.0,   1.16727, 338.370, 284.900},
+    {1000.0,  1.11166, 336.435, 281.651},
+    {2000.0,  1.00655, 332.532, 275.154},
+    {3000.0,  0.90254, 328.584, 268.659},
+    {4000.0,  0.81935, 324.589, 262.166},
+    {5000.0,  0.73643, 320.545, 255.676},
+    {6000.0,  0.66011, 316.452, 249.187},
+    {7000.0,  0.59002, 312.306, 242.700},
+    {8000.0,  0.52678, 308.105, 236.215},
+    {9000.0,  0.46706, 303.848, 229.733},
+    {10000.0, 0.41351, 299.532, 223.252},
+    {11000.0, 0.36480, 295.154, 216.774}
+};
+const int ATMOS_N = 13;
+
+double interpolate(double x, double x0, double x1, double y0, double y1) {
+    if (fabs(x1 - x0) < 1e-9) return y0;
+    return y0 + (x - x0) * (y1 - y0) / (x1 - x0);
+}
+
+// Кусочно-линейная интерполяция по уровням levels[0 .. count), H по возрастанию
+void atmosphere_levels(const AtmosPoint* levels, int count, double H, double& rho, double& a_sound) {
+    if (H <= levels[0].H) {
+        rho = levels[0].rho;
+        a_sound = levels[0].a;
+        return;
+    }
+    if (H >= levels[count - 1].H) {
+        rho = levels[count - 1].rho;
+        a_sound = levels[count - 1].a;
+        return;
+    }
+
+    for (int i = 0; i < count - 1; i++) {
+        if (H >= levels[i].H && H < levels[i + 1].H) {
+            rho = interpolate(H, levels[i].H, levels[i + 1].H,
+                levels[i].rho, levels[i + 1].rho);
+            a_sound = interpolate(H, levels[i].H, levels[i + 1].H,
+                levels[i].a, levels[i + 1].a);
+            return;
+        }
+    }
+}
+
+void atmosphere(double H, double& rho, double& a_sound) {
+    atmosphere_levels(ATMOS_TABLE, ATMOS_N, H, rho, a_sound);
+}
+
+// Атмосфера сценария до компиляции в таблицу: уровни (H, rho, a, T)
+// по возрастанию H и профиль встречного ветра (H, W), W < 0 - попутный.
+// Между точками ветер линеен, выше и ниже профиля - постоянен.
+struct AtmosphereProfile {
+    string name;
+    vector<AtmosPoint> levels;
+    vector<pair<double, double> > wind;
+};
+
+// Сдвиг температуры всех уровней на dT при том же давлении:
+// rho ~ 1/T, скорость звука ~ sqrt(T)
+void shift_temperature(AtmosphereProfile& profile, double dT) {
+    if (dT == 0.0) return;
+    for (size_t k = 0; k < profile.levels.size(); k++) {
+        AtmosPoint& p = profile.levels[k];
+        double T = p.T + dT;
+        p.rho *= p.T / T;
+        p.a *= sqrt(T / p.T);
+        p.T = T;
+    }
+}
+
+// МСА со сдвигом температуры dT
+AtmosphereProfile isa_profile(double dT) {
+    AtmosphereProfile profile;
+    profile.levels.assign(ATMOS_TABLE, ATMOS_TABLE + ATMOS_N);
+    shift_temperature(profile, dT);
+
+    ostringstream name;
+    name << "ISA";
+    if (dT != 0.0) name << showpos << dT;
+    profile.name = name.str();
+    return profile;
+}
+
+double wind_at(const vector<pair<double, double> >& wind, double H) {
+    if (wind.empty()) return 0.0;
+    if (H <= wind[0].first) return wind[0].second;
+    for (size_t k = 1; k < wind.size(); k++) {
+        if (H < wind[k].first) {
+            return interpolate(H, wind[k - 1].first, wind[k].first, wind[k - 1].second, wind[k].second);
+        }
+    }
+    return wind.back().second;
+}
+
+// Таблица атмосферы с равномерным шагом по высоте: номер интервала
+// находится умножением на 1/шаг, без поиска. Шаг 500 м делит все интервалы
+// ATMOS_TABLE, поэтому кусочно-линейная зависимость передается без потерь.
+// Таблица строится один раз на профиль и дальше только читается,
+// поэтому одну таблицу используют сразу все потоки пакета.
+struct UniformAtmosphere {
+    string name;
+    double H_min;
+    double H_max;
+    double step;
+    double inv_step;
+    int count;
+    vector<double> rho;
+    vector<double> a;
+    vector<double> wind;            // встречный ветер, м/с
+    vector<double> density_ratio;   // rho / rho МСА на той же высоте
+    unsigned long long signature;   // контрольная сумма значений (ключ кэша ребер)
+};
+
+// Шаг 500 м, если на него ложатся все точки профиля, иначе 100 м
+double atmosphere_step(const AtmosphereProfile& profile) {
+    double H_min = profile.levels[0].H;
+    bool aligned = true;
+    for (size_t k = 0; k < profile.levels.size(); k++) {
+        aligned = aligned && fmod(profile.levels[k].H - H_min, 500.0) == 0.0;
+    }
+    for (size_t k = 0; k < profile.wind.size(); k++) {
+        aligned = aligned && fmod(profile.wind[k].first - H_min, 500.0) == 0.0;
+    }
+    return aligned ? 500.0 : 100.0;
+}
+
+unsigned long long fnv1a(unsigned long long hash, const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t k = 0; k < bytes; k++) {
+        hash = (hash ^ p[k]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Таблица перестраивается на месте: при том же числе узлов память
+// не выделяется (кроме имени)
+void compile_atmosphere(const AtmosphereProfile& profile, double step, UniformAtmosphere& table) {
+    const AtmosPoint* levels = profile.levels.data();
+    int level_count = (int)profile.levels.size();
+
+    table.name = profile.name;
+    table.H_min = levels[0].H;
+    table.H_max = levels[level_count - 1].H;
+    table.step = step;
+    table.inv_step = 1.0 / step;
+    table.count = (int)((table.H_max - table.H_min) / step + 0.5) + 1;
+    table.rho.resize(table.count);
+    table.a.resize(table.count);
+    table.wind.resize(table.count);
+    table.density_ratio.resize(table.count);
+
+    for (int k = 0; k < table.count; k++) {
+        double H = table.H_min + k * step;
+        double rho_isa, a_isa;
+        atmosphere_levels(levels, level_count, H, table.rho[k], table.a[k]);
+        atmosphere(H, rho_isa, a_isa);
+        table.wind[k] = wind_at(profile.wind, H);
+        table.density_ratio[k] = table.rho[k] / rho_isa;
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = fnv1a(hash, &table.H_min, sizeof(double));
+    hash = fnv1a(hash, &table.step, sizeof(double));
+    hash = fnv1a(hash, table.rho.data(), table.count * sizeof(double));
+    hash = fnv1a(hash, table.a.data(), table.count * sizeof(double));
+    hash = fnv1a(hash, table.wind.data(), table.count * sizeof(double));
+    table.signature = hash;
+}
+
+UniformAtmosphere compile_atmosphere(const AtmosphereProfile& profile, double step) {
+    UniformAtmosphere table;
+    compile_atmosphere(profile, step, table);
+    return table;
+}
+
+static const UniformAtmosphere STANDARD_ATMOSPHERE = compile_atmosphere(isa_profile(0.0), 500.0);
+
+// O(1) вариант atmosphere() по равномерной таблице
+inline void atmosphere_fast(const UniformAtmosphere& table, double H, double& rho, double& a_sound) {
+    double h = min(max(H, table.H_min), table.H_max);
+    double x = (h - table.H_min) * table.inv_step;
+    int k = min((int)x, table.count - 2);
+    double t = x - k;
+
+    rho = table.rho[k] + t * (table.rho[k + 1] - table.rho[k]);
+    a_sound = table.a[k] + t * (table.a[k + 1] - table.a[k]);
+}
+
+inline void atmosphere_fast(double H, double& rho, double& a_sound) {
+    atmosphere_fast(STANDARD_ATMOSPHERE, H, rho, a_sound);
+}
+
+// Столбец values таблицы (wind, density_ratio) на высоте H
+inline double atmosphere_value(const UniformAtmosphere& table, const vector<double>& values, double H) {
+    double h = min(max(H, table.H_min), table.H_max);
+    double x = (h - table.H_min) * table.inv_step;
+    int k = min((int)x, table.count - 2);
+    return values[k] + (x - k) * (values[k + 1] - values[k]);
+}
+
+// Встречный ветер и его градиент по высоте dW/dH (вне таблицы - 0)
+inline double atmosphere_wind(const UniformAtmosphere& table, double H) {
+    return atmosphere_value(table, table.wind, H);
+}
+
+inline double atmosphere_wind_shear(const UniformAtmosphere& table, double H) {
+    if (H < table.H_min || H > table.H_max) return 0.0;
+    int k = min((int)((H - table.H_min) * table.inv_step), table.count - 2);
+    return (table.wind[k + 1] - table.wind[k]) * table.inv_step;
+}
+
+// Плотность и скорость звука для массива высот. С AVX2 по четыре высоты
+// за шаг (gather из таблицы); арифметика та же, что в atmosphere_fast,
+// поэтому результат не зависит от того, какой путь выбран.
+void atmosphere_batch(const UniformAtmosphere& table, const double* H, size_t count,
+    double* rho, double* a_sound) {
+    size_t k = 0;
+
+#ifdef __AVX2__
+    const __m256d h_min = _mm256_set1_pd(table.H_min);
+    const __m256d h_max = _mm256_set1_pd(table.H_max);
+    const __m256d inv_step = _mm256_set1_pd(table.inv_step);
+    const __m128i last_interval = _mm_set1_epi32(table.count - 2);
+    const double* rho_table = table.rho.data();
+    const double* a_table = table.a.data();
+    // Сбор с маской по всем дорожкам: у _mm256_i32gather_pd GCC считает
+    // исходный регистр неинициализированным (-Wmaybe-uninitialized)
+    const __m256d gather_all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    for (; k + 4 <= count; k += 4) {
+        __m256d h = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(H + k), h_min), h_max);
+        __m256d x = _mm256_mul_pd(_mm256_sub_pd(h, h_min), inv_step);
+        __m128i idx = _mm_min_epi32(_mm256_cvttpd_epi32(x), last_interval);
+        __m256d t = _mm256_sub_pd(x, _mm256_cvtepi32_pd(idx));
+
+        __m256d r0 = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), rho_table, idx, gather_all, 8);
+        __m256d r1 = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), rho_table + 1, idx, gather_all, 8);
+        _mm256_storeu_pd(rho + k, _mm256_add_pd(r0, _mm256_mul_pd(t, _mm256_sub_pd(r1, r0))));
+
+        __m256d a0 = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), a_table, idx, gather_all, 8);
+        __m256d a1 = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), a_table + 1, idx, gather_all, 8);
+        _mm256_storeu_pd(a_sound + k, _mm256_add_pd(a0, _mm256_mul_pd(t, _mm256_sub_pd(a1, a0))));
+    }
+#endif
+
+    for (; k < count; k++) {
+        atmosphere_fast(table, H[k], rho[k], a_sound[k]);
+    }
+}
+
+// Атмосфера и высотные множители модели двигателя в одной точке по высоте.
+// Все, что зависит только от H (атмосфера и pow в тяге),
+// считается один раз при построении точки.
+struct AltitudePoint {
+    double H;
+    double rho;
+    double a_sound;
+    double thrust_altitude_factor;
+    double sfc_altitude_factor;
+    double wind;  // встречный ветер, м/с
+};
+
+// Режим работы двигателей и его множитель удельного расхода (pow)
+struct PowerSetting {
+    double value;
+    double sfc_regime_factor;
+};
+
+double thrust_altitude_factor(const AircraftModel& ac, double H) {
+    double H_km = H / 1000.0;
+
+    if (H_km <= 0) {
+        return 1.0;
+    }
+    else if (H_km >= 11.0) {
+        return 1.0 - ac.thrust_lapse;
+    }
+    return 1.0 - ac.thrust_lapse * pow(H_km / 11.0, ac.thrust_lapse_power);
+}
+
+double sfc_regime_factor(double power_setting) {
+    double regime_factor;
+    if (power_setting >= 1.0) {
+        regime_factor = 1.0 + 0.45 * pow(power_setting - 1.0, 1.2);
+    }
+    else if (power_setting >= 0.88) {
+        regime_factor = 0.92 - 0.02 * (power_setting - 0.88) / 0.12;
+    }
+    else if (power_setting >= 0.70) {
+        regime_factor = 0.92 + 0.12 * pow((0.88 - power_setting) / 0.18, 1.1);
+    }
+    else {
+        regime_factor = 1.18;
+    }
+    return regime_factor;
+}
+
+// Тяга в нестандартной атмосфере пересчитывается по отношению плотностей:
+// P ~ (rho / rho_МСА)^0.7 - в жару тяга падает, в мороз растет
+const double THRUST_DENSITY_EXPONENT = 0.7;
+
+// Высотные множители двигателя; rho, a_sound и wind заполняет вызывающий
+void fill_altitude_factors(const AircraftModel& ac, const UniformAtmosphere& atm, AltitudePoint& p, double H) {
+    p.H = H;
+    p.thrust_altitude_factor = thrust_altitude_factor(ac, H) *
+        pow(atmosphere_value(atm, atm.density_ratio, H), THRUST_DENSITY_EXPONENT);
+    p.sfc_altitude_factor = 1.0 - ac.sfc_altitude * min(1.0, (H / 1000.0) / 11.0);
+}
+
+AltitudePoint make_altitude_point(const AircraftModel& ac, const UniformAtmosphere& atm, double H) {
+    AltitudePoint p;
+    fill_altitude_factors(ac, atm, p, H);
+    atmosphere_fast(atm, H, p.rho, p.a_sound);
+    p.wind = atmosphere_wind(atm, H);
+    return p;
+}
+
+// Ускорение, которое тратится на набор высоты при постоянной воздушной
+// скорости: g минус вклад сдвига ветра. Встречный ветер, растущий с высотой,
+// при подъеме сам разгоняет самолет относительно воздуха (V dW/dH).
+// Без сдвига - ровно G.
+inline double climb_gravity(const AltitudePoint& h1, const AltitudePoint& h2, double V_ms) {
+    double dH = h2.H - h1.H;
+    double shear = dH != 0.0 ? (h2.wind - h1.wind) / dH : 0.0;
+    return G - V_ms * shear;
+}
+
+PowerSetting make_power_setting(double value) {
+    PowerSetting ps;
+    ps.value = value;
+    ps.sfc_regime_factor = sfc_regime_factor(value);
+    return ps;
+}
+
+bool is_in_flight_envelope(const AircraftModel& ac, const AltitudePoint& p, double V_kmh) {
+    if (V_kmh < ac.V_min_kmh || V_kmh > ac.V_max_kmh) return false;
+    if (p.H < 0.0 || p.H > ac.H_max) return false;
+
+    double M = (V_kmh / 3.6) / p.a_sound;
+
+    if (M > ac.M_max) return false;
+
+    return true;
+}
+
+double Cx_alpha(const AircraftModel& ac, double alpha_deg) {
+    if (alpha_deg < 0.0) alpha_deg = 0.0;
+    if (alpha_deg > ac.alpha_max) alpha_deg = ac.alpha_max;
+
+    double Cy = ac.cy0 + ac.cy1 * alpha_deg;
+    double Cx = ac.cx0 + ac.k_induced * Cy * Cy;
+
+    if (Cx < ac.cx_min) Cx = ac.cx_min;
+
+    return Cx;
+}
+
+double thrust_single(const AircraftModel& ac, double altitude_factor, double M) {
+    double mach_factor = ac.thrust_mach0 + ac.thrust_mach_slope * M;
+    if (mach_factor > ac.thrust_mach_max) mach_factor = ac.thrust_mach_max;
+
+    return ac.thrust_sea * altitude_factor * mach_factor;
+}
+
+double thrust_single_nominal(const AircraftModel& ac, double H, double M) {
+    return thrust_single(ac, thrust_altitude_factor(ac, H), M);
+}
+
+double total_thrust(const AircraftModel& ac, const AltitudePoint& p, double V_ms) {
+    double M = V_ms / p.a_sound;
+
+    double P_single = thrust_single(ac, p.thrust_altitude_factor, M);
+    return P_single * ac.engine_count * (ac.thrust_percent / 100.0);
+}
+
+double specific_fuel_consumption(const AircraftModel& ac, const AltitudePoint& p, double V_ms, const PowerSetting& ps) {
+    double M = V_ms / p.a_sound;
+
+    double mach_factor = 1.0 + ac.sfc_mach * max(0.0, M - 0.5);
+
+    double Cp = ac.cp_base * ps.sfc_regime_factor * p.sfc_altitude_factor * mach_factor;
+    return Cp / 9.81;
+}
+
+// P - полная тяга в этой точке (total_thrust), считается вызывающим один раз
+double calculate_alpha(const AircraftModel& ac, const AltitudePoint& p, double V_ms, double mass, double P) {
+    double q = 0.5 * p.rho * V_ms * V_ms;
+
+    if (q < 100.0) return 8.0;
+
+    double alpha_deg = (mass * G - P / DEG_TO_RAD - ac.cy0 * q * ac.wing_area) / (ac.cy1 * q * ac.wing_area);
+
+    if (alpha_deg < 0.0) alpha_deg = 0.0;
+    if (alpha_deg > ac.alpha_max) alpha_deg = ac.alpha_max;
+
+    return alpha_deg;
+}
+
+struct SegmentData {
+    double time;
+    double fuel;
+    bool valid;
+};
+
+// Маневры считаются сразу для нескольких режимов двигателей, по одному
+// режиму на дорожку. Все, что от режима не зависит (атмосфера, угол атаки,
+// сопротивление, проверки области полета), считается один раз на участок,
+// а зависящая от режима часть - циклом по PS_LANES дорожкам без ветвлений:
+// отбраковка (dV_dt <= 0.01, sin_theta <= 0.005 и т.д.) превращается в маску
+// valid, а время и топливо выбираются по маске. Такой цикл компилятор
+// разворачивает в векторные инструкции.
+const int PS_LANES = 4;
+
+struct PowerLanes {
+    int count;
+    double value[PS_LANES];
+    double sfc_regime_factor[PS_LANES];
+};
+
+struct SegmentLanes {
+    double time[PS_LANES];
+    double fuel[PS_LANES];
+    bool valid[PS_LANES];
+};
+
+// Режимы settings[first .. first + PS_LANES), недостающие дорожки повторяют
+// первый режим и в результате помечаются недействительными
+PowerLanes make_power_lanes(const vector<PowerSetting>& settings, size_t first) {
+    PowerLanes lanes;
+    lanes.count = (int)min((size_t)PS_LANES, settings.size() - first);
+    for (int k = 0; k < PS_LANES; k++) {
+        const PowerSetting& ps = settings[first + (k < lanes.count ? k : 0)];
+        lanes.value[k] = ps.value;
+        lanes.sfc_regime_factor[k] = ps.sfc_regime_factor;
+    }
+    return lanes;
+}
+
+// Счетчики исходов ядер участков (сборка с -DDZ_COUNTERS, по умолчанию
+// их нет в коде). Считается каждая дорожка режима: допустима или по какой
+// проверке отбракована. У каждого потока свой блок счетчиков, выровненный
+// по строке кэша, поэтому потоки не делят строки и обходятся без атомиков;
+// блоки суммируются только при выводе отчета.
+enum KernelEvent {
+    EV_RAZGON_VALID,
+    EV_RAZGON_ENVELOPE,
+    EV_RAZGON_DV_DT,
+    EV_RAZGON_DT,
+    EV_PODIEM_VALID,
+    EV_PODIEM_MIN_SPEED,
+    EV_PODIEM_ENVELOPE,
+    EV_PODIEM_EXCESS,
+    EV_PODIEM_SIN_THETA,
+    EV_PODIEM_DT,
+    EV_RP_VALID,
+    EV_RP_MIN_SPEED,
+    EV_RP_ENVELOPE,
+    EV_RP_DT,
+    EV_RP_VY_LOW,
+    EV_RP_VY_HIGH,
+    EV_RP_DV_DT,
+    EV_RP_RAZGON,
+    EV_RP_PODIEM,
+    EV_OBMEN_VALID,
+    EV_OBMEN_MIN_SPEED,
+    EV_OBMEN_ENVELOPE,
+    EV_OBMEN_PS,
+    EV_OBMEN_DIRECTION,
+    EV_OBMEN_DT,
+    KERNEL_EVENT_COUNT
+};
+
+#ifdef DZ_COUNTERS
+// Блок выдается потоку при первом счете и возвращается в список свободных
+// при завершении потока, так что пулы, создаваемые заново (пакет, тест
+// производительности), не расходуют блоки. Счетчики блока при этом
+// остаются - следующий владелец досчитывает в них же. Если одновременно
+// живых потоков больше COUNTER_SLOTS, лишние считают в общий блок
+// атомарными сложениями (медленнее, но без гонок).
+const int COUNTER_SLOTS = 256;
+
+struct alignas(64) KernelCounters {
+    long long events[KERNEL_EVENT_COUNT];
+};
+
+KernelCounters kernel_counters[COUNTER_SLOTS];
+atomic<long long> kernel_overflow_counters[KERNEL_EVENT_COUNT];
+atomic<int> kernel_counter_threads(0);
+
+// Выданные блоки 0 .. kernel_counter_slots - 1 и свободные из них
+mutex kernel_counter_mutex;
+int kernel_counter_slots = 0;
+vector<int> kernel_counter_free;
+
+// > 0 - внутри составного маневра, его части не считаются
+thread_local int kernel_counter_nested = 0;
+
+// Блок потока: index < 0 - блоков не хватило
+struct CounterSlot {
+    int index;
+
+    CounterSlot() {
+        kernel_counter_threads.fetch_add(1);
+        lock_guard<mutex> lock(kernel_counter_mutex);
+        if (!kernel_counter_free.empty()) {
+            index = kernel_counter_free.back();
+            kernel_counter_free.pop_back();
+        }
+        else {
+            index = kernel_counter_slots < COUNTER_SLOTS ? kernel_counter_slots++ : -1;
+        }
+    }
+
+    ~CounterSlot() {
+        if (index < 0) return;
+        lock_guard<mutex> lock(kernel_counter_mutex);
+        kernel_counter_free.push_back(index);
+    }
+};
+
+// NULL - поток без своего блока
+inline KernelCounters* thread_counters() {
+    static thread_local CounterSlot slot;
+    return slot.index >= 0 ? &kernel_counters[slot.index] : NULL;
+}
+
+inline void count_kernel_event(KernelEvent event, int lanes) {
+    if (kernel_counter_nested != 0 && event < EV_RP_VALID) return;
+    KernelCounters* counters = thread_counters();
+    if (counters != NULL) counters->events[event] += lanes;
+    else kernel_overflow_counters[event].fetch_add(lanes, memory_order_relaxed);
+}
+
+#define KERNEL_COUNT(event, lanes) count_kernel_event(event, lanes)
+#define KERNEL_COUNT_NESTED(delta) (kernel_counter_nested += (delta))
+#else
+#define KERNEL_COUNT(event, lanes) ((void)0)
+#define KERNEL_COUNT_NESTED(delta) ((void)0)
+#endif
+
+void reject_lanes(SegmentLanes& out) {
+    for (int k = 0; k < PS_LANES; k++) {
+        out.time[k] = 1e9;
+        out.fuel[k] = 1e9;
+        out.valid[k] = false;
+    }
+}
+
+// Удельный расход по дорожкам: c_p * P_used * dt / 3600 с выбором по маске
+inline void finish_lanes(const AircraftModel& ac, const AltitudePoint& h, double V_ms, const PowerLanes& ps,
+    const double* P_used, const double* dt, SegmentLanes& out) {
+    double M = V_ms / h.a_sound;
+    double mach_factor = 1.0 + ac.sfc_mach * max(0.0, M - 0.5);
+
+    for (int k = 0; k < PS_LANES; k++) {
+        double Cp = ac.cp_base * ps.sfc_regime_factor[k] * h.sfc_altitude_factor * mach_factor;
+        double c_p = Cp / 9.81;
+        double fuel = c_p * P_used[k] * dt[k] / 3600.0;
+        bool valid = out.valid[k] && k < ps.count;
+
+        out.valid[k] = valid;
+        out.time[k] = valid ? dt[k] : 1e9;
+        out.fuel[k] = valid ? fuel : 1e9;
+    }
+}
+
+void calculate_razgon_lanes(const AircraftModel& ac, const AltitudePoint& h, double V1_ms, double V2_ms, double mass,
+    const PowerLanes& ps, SegmentLanes& out) {
+    if (!is_in_flight_envelope(ac, h, V1_ms * 3.6) || !is_in_flight_envelope(ac, h, V2_ms * 3.6)) {
+        KERNEL_COUNT(EV_RAZGON_ENVELOPE, ps.count);
+        reject_lanes(out);
+        return;
+    }
+
+    double V_avg = 0.5 * (V1_ms + V2_ms);
+    double P_max = total_thrust(ac, h, V_avg);
+    double alpha_deg = calculate_alpha(ac, h, V_avg, mass, P_max);
+    double cos_alpha = cos(alpha_deg / DEG_TO_RAD);
+
+    double q = 0.5 * h.rho * V_avg * V_avg;
+
+    double Cx = Cx_alpha(ac, alpha_deg);
+    double X = Cx * q * ac.wing_area;
+
+    double P_used[PS_LANES], dt[PS_LANES];
+    for (int k = 0; k < PS_LANES; k++) {
+        P_used[k] = P_max * ps.value[k];
+        double dV_dt = (P_used[k] * cos_alpha - X) / mass;
+        dt[k] = (V2_ms - V1_ms) / dV_dt;
+        out.valid[k] = !(dV_dt <= 0.01) && !(dt[k] > 1000.0 || dt[k] <= 0);
+        if (k < ps.count) {
+            KERNEL_COUNT(out.valid[k] ? EV_RAZGON_VALID : dV_dt <= 0.01 ? EV_RAZGON_DV_DT : EV_RAZGON_DT, 1);
+        }
+    }
+
+    finish_lanes(ac, h, V_avg, ps, P_used, dt, out);
+}
+
+// h1, h2 - концы участка, h_avg - его середина
+void calculate_podiem_lanes(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V_ms, double mass, const PowerLanes& ps, double max_vy_factor, SegmentLanes& out) {
+    if (V_ms * 3.6 < MIN_CLIMB_SPEED_KMH ||
+        !is_in_flight_envelope(ac, h1, V_ms * 3.6) || !is_in_flight_envelope(ac, h2, V_ms * 3.6)) {
+        KERNEL_COUNT(V_ms * 3.6 < MIN_CLIMB_SPEED_KMH ? EV_PODIEM_MIN_SPEED : EV_PODIEM_ENVELOPE, ps.count);
+        reject_lanes(out);
+        return;
+    }
+
+    double P_max = total_thrust(ac, h_avg, V_ms);
+    double alpha_deg = calculate_alpha(ac, h_avg, V_ms, mass, P_max);
+
+    double q = 0.5 * h_avg.rho * V_ms * V_ms;
+
+    double Cx = Cx_alpha(ac, alpha_deg);
+    double X = Cx * q * ac.wing_area;
+
+    double theta_max_rad = MAX_CLIMB_ANGLE / DEG_TO_RAD;
+    double sin_theta_max = sin(theta_max_rad);
+    double max_vy_limit = MAX_VERTICAL_SPEED * max_vy_factor;
+    double dH = h2.H - h1.H;
+    double g_climb = climb_gravity(h1, h2, V_ms);
+
+    double P_used[PS_LANES], dt[PS_LANES];
+    for (int k = 0; k < PS_LANES; k++) {
+        P_used[k] = P_max * ps.value[k];
+        double P_excess = P_used[k] - X;
+        double sin_theta = min(P_excess / (mass * g_climb), sin_theta_max);
+        double Vy = min(V_ms * sin_theta, max_vy_limit);
+        dt[k] = dH / Vy;
+        out.valid[k] = !(P_excess <= 0) && !(sin_theta <= 0.005) && !(dt[k] <= 0 || dt[k] > 2000.0);
+        if (k < ps.count) {
+            KERNEL_COUNT(out.valid[k] ? EV_PODIEM_VALID : P_excess <= 0 ? EV_PODIEM_EXCESS :
+                sin_theta <= 0.005 ? EV_PODIEM_SIN_THETA : EV_PODIEM_DT, 1);
+        }
+    }
+
+    finish_lanes(ac, h_avg, V_ms, ps, P_used, dt, out);
+}
+
+// На одну ячейку сетки время участка задают кинематические пределы.
+// lane_rates - участок на несколько ячеек (переходы A* с --stencil):
+// избыток тяги тратится и на высоту, и на скорость, поэтому участок не
+// короче подъема и разгона на том же режиме подряд (энергетический метод),
+// иначе длинные участки с полными темпами по H и V дают выигрыш сетки.
+void calculate_razgon_podiem_lanes(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V1_ms, double V2_ms, double mass, const PowerLanes& ps, double max_vy_factor, bool lane_rates, SegmentLanes& out) {
+    double V_avg = 0.5 * (V1_ms + V2_ms);
+
+    // Время и темпы участка от режима не зависят: проверяем их до физики
+    double dH = h2.H - h1.H;
+    double dV_kmh = (V2_ms - V1_ms) * 3.6;
+
+    double time_for_climb = dH / 5.0;
+    double time_for_accel = fabs(dV_kmh) / 15.0;
+
+    double dt = max(time_for_climb, time_for_accel);
+    double Vy = dH / dt;
+    double max_vy_limit = MAX_VERTICAL_SPEED * max_vy_factor * 1.2;
+    double dV_dt = (V2_ms - V1_ms) / dt;
+
+    if (V_avg * 3.6 < (MIN_CLIMB_SPEED_KMH * 0.95) ||
+        !is_in_flight_envelope(ac, h1, V1_ms * 3.6) || !is_in_flight_envelope(ac, h2, V2_ms * 3.6) ||
+        dt <= 0 || dt > 3000.0 || Vy < 0.3 || Vy > max_vy_limit || fabs(dV_dt) > 5.0) {
+        KERNEL_COUNT(V_avg * 3.6 < (MIN_CLIMB_SPEED_KMH * 0.95) ? EV_RP_MIN_SPEED :
+            (!is_in_flight_envelope(ac, h1, V1_ms * 3.6) || !is_in_flight_envelope(ac, h2, V2_ms * 3.6)) ? EV_RP_ENVELOPE :
+            (dt <= 0 || dt > 3000.0) ? EV_RP_DT : Vy < 0.3 ? EV_RP_VY_LOW : Vy > max_vy_limit ? EV_RP_VY_HIGH :
+            EV_RP_DV_DT, ps.count);
+        reject_lanes(out);
+        return;
+    }
+
+    SegmentLanes razgon, podiem;
+    KERNEL_COUNT_NESTED(1);
+    calculate_razgon_lanes(ac, h_avg, V1_ms, V2_ms, mass, ps, razgon);
+    calculate_podiem_lanes(ac, h1, h2, h_avg, V_avg, mass, ps, max_vy_factor, podiem);
+    KERNEL_COUNT_NESTED(-1);
+
+    double P_max = total_thrust(ac, h_avg, V_avg);
+
+    double P_used[PS_LANES], dt_lanes[PS_LANES];
+    for (int k = 0; k < PS_LANES; k++) {
+        P_used[k] = P_max * ps.value[k];
+        dt_lanes[k] = lane_rates ? max(dt, razgon.time[k] + podiem.time[k]) : dt;
+        out.valid[k] = razgon.valid[k] && podiem.valid[k];
+        if (k < ps.count) {
+            KERNEL_COUNT(out.valid[k] ? EV_RP_VALID : !razgon.valid[k] ? EV_RP_RAZGON : EV_RP_PODIEM, 1);
+        }
+    }
+
+    finish_lanes(ac, h_avg, V_avg, ps, P_used, dt_lanes, out);
+}
+
+// Обмен скорости на высоту (подъем с торможением, снижение с разгоном):
+// энергетический метод. Удельная энергия меняется на dHe = dH + (V2^2 - V1^2) / 2g,
+// скорость ее изменения - избыток мощности Ps = (P - X) V / (m g). Часть dHe
+// дает сдвиг ветра: V (W2 - W1) / g, ее двигателям добирать не нужно.
+// Время участка не меньше dHe / Ps и кинематических пределов по Vy и dV/dt;
+// режим, при котором энергия меняется не в ту сторону, недопустим.
+void calculate_energy_trade_lanes(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V1_ms, double V2_ms, double mass, const PowerLanes& ps, double max_vy_factor, SegmentLanes& out) {
+    double V_avg = 0.5 * (V1_ms + V2_ms);
+
+    if (V_avg * 3.6 < (MIN_CLIMB_SPEED_KMH * 0.95) ||
+        !is_in_flight_envelope(ac, h1, V1_ms * 3.6) || !is_in_flight_envelope(ac, h2, V2_ms * 3.6)) {
+        KERNEL_COUNT(V_avg * 3.6 < (MIN_CLIMB_SPEED_KMH * 0.95) ? EV_OBMEN_MIN_SPEED : EV_OBMEN_ENVELOPE, ps.count);
+        reject_lanes(out);
+        return;
+    }
+
+    double P_max = total_thrust(ac, h_avg, V_avg);
+    double alpha_deg = calculate_alpha(ac, h_avg, V_avg, mass, P_max);
+    double q = 0.5 * h_avg.rho * V_avg * V_avg;
+    double X = Cx_alpha(ac, alpha_deg) * q * ac.wing_area;
+
+    double dH = h2.H - h1.H;
+    double dHe = dH + (V2_ms * V2_ms - V1_ms * V1_ms) / (2.0 * G) - V_avg * (h2.wind - h1.wind) / G;
+    double dt_kinematic = max(fabs(dH) / (MAX_VERTICAL_SPEED * max_vy_factor), fabs(V2_ms - V1_ms) / (15.0 / 3.6));
+
+    double P_used[PS_LANES], dt[PS_LANES];
+    for (int k = 0; k < PS_LANES; k++) {
+        P_used[k] = P_max * ps.value[k];
+        double Ps = (P_used[k] - X) * V_avg / (mass * G);
+        double dt_energy = dHe / Ps;
+        dt[k] = max(dt_kinematic, dt_energy);
+        out.valid[k] = !(fabs(Ps) <= 0.01) && !(dt_energy < 0) && !(dt[k] <= 0 || dt[k] > 3000.0);
+        if (k < ps.count) {
+            KERNEL_COUNT(out.valid[k] ? EV_OBMEN_VALID : fabs(Ps) <= 0.01 ? EV_OBMEN_PS :
+                dt_energy < 0 ? EV_OBMEN_DIRECTION : EV_OBMEN_DT, 1);
+        }
+    }
+
+    finish_lanes(ac, h_avg, V_avg, ps, P_used, dt, out);
+}
+
+#ifdef DZ_COUNTERS
+struct KernelEventInfo {
+    const char* maneuver;
+    const char* reason;  // NULL - допустимые дорожки
+};
+
+const KernelEventInfo KERNEL_EVENTS[KERNEL_EVENT_COUNT] = {
+    { "RAZGON", NULL },
+    { "RAZGON", "vne oblasti poleta" },
+    { "RAZGON", "dV/dt <= 0.01" },
+    { "RAZGON", "dt vne (0, 1000]" },
+    { "PODIEM", NULL },
+    { "PODIEM", "V < V min podiema" },
+    { "PODIEM", "vne oblasti poleta" },
+    { "PODIEM", "net izbytka tyagi" },
+    { "PODIEM", "sin(theta) <= 0.005" },
+    { "PODIEM", "dt vne (0, 2000]" },
+    { "RAZGON_PODIEM", NULL },
+    { "RAZGON_PODIEM", "V < V min podiema" },
+    { "RAZGON_PODIEM", "vne oblasti poleta" },
+    { "RAZGON_PODIEM", "dt vne (0, 3000]" },
+    { "RAZGON_PODIEM", "Vy < 0.3" },
+    { "RAZGON_PODIEM", "Vy > predela" },
+    { "RAZGON_PODIEM", "|dV/dt| > 5" },
+    { "RAZGON_PODIEM", "nedopustim razgon" },
+    { "RAZGON_PODIEM", "nedopustim podiem" },
+    { "OBMEN_ENERGII", NULL },
+    { "OBMEN_ENERGII", "V < V min podiema" },
+    { "OBMEN_ENERGII", "vne oblasti poleta" },
+    { "OBMEN_ENERGII", "|Ps| <= 0.01" },
+    { "OBMEN_ENERGII", "energiya ne v tu storonu" },
+    { "OBMEN_ENERGII", "dt vne (0, 3000]" }
+};
+
+// Сумма счетчиков всех потоков: по каждому маневру - число дорожек,
+// доли допустимых и отбракованных и разбивка отбраковки по проверкам
+void report_kernel_counters(ostream& out) {
+    long long totals[KERNEL_EVENT_COUNT] = { 0 };
+    int threads = kernel_counter_threads.load();
+    int slots;
+    {
+        lock_guard<mutex> lock(kernel_counter_mutex);
+        slots = kernel_counter_slots;
+    }
+    for (int t = 0; t < slots; t++) {
+        for (int e = 0; e < KERNEL_EVENT_COUNT; e++) {
+            totals[e] += kernel_counters[t].events[e];
+        }
+    }
+    for (int e = 0; e < KERNEL_EVENT_COUNT; e++) {
+        totals[e] += kernel_overflow_counters[e].load();
+    }
+
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision(2);
+    out << fixed;
+    out << "\nSchetchiki yader uchastkov (dorozhki rezhimov, potokov: " << threads << "):\n";
+    for (int first = 0; first < KERNEL_EVENT_COUNT;) {
+        int last = first + 1;
+        while (last < KERNEL_EVENT_COUNT && KERNEL_EVENTS[last].reason != NULL) last++;
+
+        long long evaluated = 0;
+        for (int e = first; e < last; e++) evaluated += totals[e];
+        if (evaluated > 0) {
+            out << "  " << KERNEL_EVENTS[first].maneuver << ": " << evaluated << ", dopustimo "
+                << 100.0 * totals[first] / evaluated << "%, otbrakovano "
+                << 100.0 * (evaluated - totals[first]) / evaluated << "%\n";
+            for (int e = first + 1; e < last; e++) {
+                if (totals[e] == 0) continue;
+                out << "    " << left << setw(26) << KERNEL_EVENTS[e].reason << right << setw(14) << totals[e]
+                    << setw(8) << 100.0 * totals[e] / evaluated << "%\n";
+            }
+        }
+        first = last;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+#endif
+
+SegmentData lane_segment(const SegmentLanes& lanes, int k) {
+    SegmentData seg;
+    seg.time = lanes.time[k];
+    seg.fuel = lanes.fuel[k];
+    seg.valid = lanes.valid[k];
+    return seg;
+}
+
+PowerLanes single_power_lane(const PowerSetting& ps) {
+    vector<PowerSetting> settings(1, ps);
+    return make_power_lanes(settings, 0);
+}
+
+// Один режим - одна дорожка
+SegmentData calculate_razgon(const AircraftModel& ac, const AltitudePoint& h, double V1_ms, double V2_ms, double mass, const PowerSetting& ps) {
+    SegmentLanes out;
+    calculate_razgon_lanes(ac, h, V1_ms, V2_ms, mass, single_power_lane(ps), out);
+    return lane_segment(out, 0);
+}
+
+SegmentData calculate_podiem(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V_ms, double mass, const PowerSetting& ps, double max_vy_factor) {
+    SegmentLanes out;
+    calculate_podiem_lanes(ac, h1, h2, h_avg, V_ms, mass, single_power_lane(ps), max_vy_factor, out);
+    return lane_segment(out, 0);
+}
+
+SegmentData calculate_razgon_podiem(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V1_ms, double V2_ms, double mass, const PowerSetting& ps, double max_vy_factor) {
+    SegmentLanes out;
+    calculate_razgon_podiem_lanes(ac, h1, h2, h_avg, V1_ms, V2_ms, mass, single_power_lane(ps), max_vy_factor, false, out);
+    return lane_segment(out, 0);
+}
+
+// Варианты для произвольной высоты в стандартной атмосфере:
+// атмосфера и режим считаются на месте
+SegmentData calculate_razgon(const AircraftModel& ac, double H, double V1_ms, double V2_ms, double mass, double power_setting) {
+    const UniformAtmosphere& atm = STANDARD_ATMOSPHERE;
+    return calculate_razgon(ac, make_altitude_point(ac, atm, H), V1_ms, V2_ms, mass, make_power_setting(power_setting));
+}
+
+SegmentData calculate_podiem(const AircraftModel& ac, double H1, double H2, double V_ms, double mass, double power_setting, double max_vy_factor) {
+    const UniformAtmosphere& atm = STANDARD_ATMOSPHERE;
+    return calculate_podiem(ac, make_altitude_point(ac, atm, H1), make_altitude_point(ac, atm, H2),
+        make_altitude_point(ac, atm, 0.5 * (H1 + H2)), V_ms, mass, make_power_setting(power_setting), max_vy_factor);
+}
+
+SegmentData calculate_razgon_podiem(const AircraftModel& ac, double H1, double H2, double V1_ms, double V2_ms, double mass, double power_setting, double max_vy_factor) {
+    const UniformAtmosphere& atm = STANDARD_ATMOSPHERE;
+    return calculate_razgon_podiem(ac, make_altitude_point(ac, atm, H1), make_altitude_point(ac, atm, H2),
+        make_altitude_point(ac, atm, 0.5 * (H1 + H2)), V1_ms, V2_ms, mass, make_power_setting(power_setting), max_vy_factor);
+}
+
+// Торможение и снижение выполняются на малом газе. Прямой обход сетки
+// их не использует (высота и скорость по сетке только растут), они нужны
+// поиску по графу состояний, где разрешены обратные переходы.
+const double IDLE_POWER = 0.30;
+const double MAX_DECELERATION = 5.0;
+
+// Торможение на постоянной высоте, V2 < V1
+SegmentData calculate_tormozhenie(const AircraftModel& ac, const AltitudePoint& h, double V1_ms, double V2_ms, double mass,
+    const PowerSetting& idle) {
+    SegmentData result;
+    result.valid = false;
+    result.time = 1e9;
+    result.fuel = 1e9;
+
+    if (!is_in_flight_envelope(ac, h, V1_ms * 3.6) || !is_in_flight_envelope(ac, h, V2_ms * 3.6)) {
+        return result;
+    }
+
+    double V_avg = 0.5 * (V1_ms + V2_ms);
+    double P_used = total_thrust(ac, h, V_avg) * idle.value;
+    double alpha_deg = calculate_alpha(ac, h, V_avg, mass, P_used);
+    double cos_alpha = cos(alpha_deg / DEG_TO_RAD);
+
+    double q = 0.5 * h.rho * V_avg * V_avg;
+    double X = Cx_alpha(ac, alpha_deg) * q * ac.wing_area;
+
+    double dV_dt = (P_used * cos_alpha - X) / mass;
+    if (dV_dt >= -0.01 || dV_dt < -MAX_DECELERATION) return result;
+
+    double dt = (V2_ms - V1_ms) / dV_dt;
+    if (dt > 1000.0 || dt <= 0) return result;
+
+    result.time = dt;
+    result.fuel = specific_fuel_consumption(ac, h, V_avg, idle) * P_used * dt / 3600.0;
+    result.valid = true;
+    return result;
+}
+
+// Снижение с постоянной скоростью, h1 выше h2
+SegmentData calculate_snizhenie(const AircraftModel& ac, const AltitudePoint& h1, const AltitudePoint& h2, const AltitudePoint& h_avg,
+    double V_ms, double mass, const PowerSetting& idle) {
+    SegmentData result;
+    result.valid = false;
+    result.time = 1e9;
+    result.fuel = 1e9;
+
+    if (!is_in_flight_envelope(ac, h1, V_ms * 3.6) || !is_in_flight_envelope(ac, h2, V_ms * 3.6)) {
+        return result;
+    }
+
+    double P_used = total_thrust(ac, h_avg, V_ms) * idle.value;
+    double alpha_deg = calculate_alpha(ac, h_avg, V_ms, mass, P_used);
+
+    double q = 0.5 * h_avg.rho * V_ms * V_ms;
+    double X = Cx_alpha(ac, alpha_deg) * q * ac.wing_area;
+
+    double sin_theta = min((X - P_used) / (mass * climb_gravity(h1, h2, V_ms)), sin(MAX_CLIMB_ANGLE / DEG_TO_RAD));
+    if (sin_theta <= 0.005) return result;
+
+    double Vy = min(V_ms * sin_theta, MAX_VERTICAL_SPEED);
+    double dt = (h1.H - h2.H) / Vy;
+    if (dt <= 0 || dt > 2000.0) return result;
+
+    result.time = dt;
+    result.fuel = specific_fuel_consumption(ac, h_avg, V_ms, idle) * P_used * dt / 3600.0;
+    result.valid = true;
+    return result;
+}
+
+// Итоги пересчета пути интегрированием по времени (--refine)
+struct RefineSummary {
+    bool done;
+    double time;
+    double fuel;
+    double max_segment_deviation;  // наибольшее расхождение участка с ДП, %
+    int steps;
+    int rejected_steps;
+    int failed_segments;
+};
+
+struct TrajectoryResult {
+    vector<pair<double, double> > path;
+    vector<ManeuverType> maneuvers;
+    vector<double> segment_times;
+    vector<double> segment_fuels;
+    double total_time;
+    double total_fuel;
+    double avg_vy;
+    int used_razgon;
+    int used_podiem;
+    int used_combined;
+    int used_reverse;
+    string name;
+    bool found;
+    vector<double> point_masses;
+    vector<double> segment_powers;
+    RefineSummary refine;
+};
+
+// Пул потоков для волнового обхода сетки.
+// parallel_for раздает диапазон [0, count) порциями по chunk элементов
+// и возвращает управление только после обработки всех порций. Тело
+// передается указателем и функцией вызова без std::function, поэтому
+// запуск задания память не выделяет.
+class ThreadPool {
+public:
+    explicit ThreadPool(int thread_count)
+        : stop(false), generation(0), pending(0), job(NULL), job_call(NULL), job_count(0), job_chunk(1) {
+        next_index = 0;
+        for (int t = 1; t < thread_count; t++) {
+            workers.push_back(thread(&ThreadPool::worker_loop, this));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    int size() const {
+        return (int)workers.size() + 1;
+    }
+
+    template <class Body>
+    void parallel_for(int count, int chunk, const Body& body) {
+        if (count <= 0) return;
+        if (chunk < 1) chunk = 1;
+        if (workers.empty() || count <= chunk) {
+            body(0, count);
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            job = &body;
+            job_call = [](const void* f, int begin, int end) { (*static_cast<const Body*>(f))(begin, end); };
+            job_count = count;
+            job_chunk = chunk;
+            next_index = 0;
+            pending = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        run_chunks();
+
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return pending == 0; });
+        job = NULL;
+    }
+
+private:
+    void run_chunks() {
+        while (true) {
+            int begin = next_index.fetch_add(job_chunk);
+            if (begin >= job_count) break;
+            job_call(job, begin, min(job_count, begin + job_chunk));
+        }
+    }
+
+    void worker_loop() {
+        long long seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [this, seen] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+
+            run_chunks();
+
+            lock_guard<mutex> lock(m);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    vector<thread> workers;
+    mutex m;
+    condition_variable wake;
+    condition_variable done;
+    bool stop;
+    long long generation;
+    int pending;
+    const void* job;
+    void (*job_call)(const void*, int, int);
+    int job_count;
+    int job_chunk;
+    atomic<int> next_index;
+};
+
+// Пул потоков с кражей работы для пакетного режима.
+// Задачи раскладываются по очередям потоков; поток берет задачи с конца
+// своей очереди, а когда она пуста - крадет с начала чужих очередей.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int thread_count)
+        : queues(thread_count), stop(false), generation(0), pending(0), job(NULL) {
+        for (int t = 1; t < thread_count; t++) {
+            workers.push_back(thread(&WorkStealingPool::worker_loop, this, t));
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    int size() const {
+        return (int)queues.size();
+    }
+
+    // Выполняет body(worker, task) для всех task из [0, task_count),
+    // worker - номер потока из [0, size())
+    void run(int task_count, const function<void(int, int)>& body) {
+        for (int t = 0; t < task_count; t++) {
+            TaskQueue& q = queues[t % size()];
+            lock_guard<mutex> lock(q.m);
+            q.tasks.push_back(t);
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            job = &body;
+            pending = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        run_tasks(0);
+
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return pending == 0; });
+        job = NULL;
+    }
+
+private:
+    struct TaskQueue {
+        mutex m;
+        deque<int> tasks;
+    };
+
+    bool pop_local(int worker, int& task) {
+        TaskQueue& q = queues[worker];
+        lock_guard<mutex> lock(q.m);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.back();
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int worker, int& task) {
+        for (int k = 1; k < size(); k++) {
+            TaskQueue& q = queues[(worker + k) % size()];
+            lock_guard<mutex> lock(q.m);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.front();
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    // Новые задачи появляются только в run(), поэтому пустые очереди
+    // означают конец работы
+    void run_tasks(int worker) {
+        int task;
+        while (pop_local(worker, task) || steal(worker, task)) {
+            (*job)(worker, task);
+        }
+    }
+
+    void worker_loop(int worker) {
+        long long seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [this, seen] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+
+            run_tasks(worker);
+
+            lock_guard<mutex> lock(m);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    vector<TaskQueue> queues;
+    vector<thread> workers;
+    mutex m;
+    condition_variable wake;
+    condition_variable done;
+    bool stop;
+    long long generation;
+    int pending;
+    const function<void(int, int)>* job;
+};
+
+// Строка таблиц ДП: указатели на начало строки i в массивах
+// стоимости, времени, топлива и кодов входящего маневра
+struct DPRow {
+    double* cost;
+    double* time;
+    double* fuel;
+    unsigned char* code;
+    unsigned short* setting;  // номер режима двигателей участка (physics.settings)
+};
+
+// Хранилище таблиц ДП по сетке (H, V).
+// В полном режиме стоимость, время и топливо лежат в одном непрерывном блоке
+// (структура массивов, узел (i, j) -> i * (n + 1) + j).
+// В потоковом режиме хранятся только две строки, а путь восстанавливается
+// по упакованным 2-битовым кодам маневров (0 - нет пути, иначе ManeuverType).
+// Маневр однозначно задает предшественника, поэтому prev_i/prev_j не нужны.
+// Рядом с кодом хранится номер режима двигателей участка; в потоковом
+// режиме - только для двух строк, режим пути находится пересчетом участка.
+class DPStore {
+public:
+    DPStore() : n(0), stride(0), stream(false), packed_row_bytes(0) {}
+
+    // Память под сетку до max_n x max_n: последующие reset с n <= max_n
+    // в том же режиме ничего не выделяют
+    void reserve(int max_n, bool streaming) {
+        size_t max_stride = (size_t)max_n + 1;
+        size_t rows = streaming ? 2 : max_stride;
+        block.reserve(3 * rows * max_stride);
+        codes.reserve(rows * max_stride);
+        settings.reserve(rows * max_stride);
+        if (streaming) {
+            packed.reserve((max_stride + 3) / 4 * max_stride);
+        }
+    }
+
+    void reset(int grid_n, bool streaming) {
+        n = grid_n;
+        stride = (size_t)n + 1;
+        stream = streaming;
+
+        size_t rows = stream ? 2 : stride;
+        block.assign(3 * rows * stride, 0.0);
+        fill(block.begin(), block.begin() + rows * stride, 1e9);
+        codes.assign(rows * stride, 0);
+        settings.assign(rows * stride, 0);
+
+        if (stream) {
+            packed_row_bytes = (stride + 3) / 4;
+            packed.assign(packed_row_bytes * stride, 0);
+        }
+        else {
+            packed_row_bytes = 0;
+            packed.clear();
+        }
+        block[0] = 0.0;
+    }
+
+    bool streaming() const {
+        return stream;
+    }
+
+    DPRow row(int i) {
+        size_t rows = stream ? 2 : stride;
+        size_t offset = (stream ? (size_t)(i & 1) : (size_t)i) * stride;
+        DPRow r;
+        r.cost = &block[offset];
+        r.time = &block[rows * stride + offset];
+        r.fuel = &block[2 * rows * stride + offset];
+        r.code = &codes[offset];
+        r.setting = &settings[offset];
+        return r;
+    }
+
+    // В потоковом режиме строка i занимает буфер строки i-2, его нужно очистить
+    DPRow begin_row(int i) {
+        DPRow r = row(i);
+        if (stream && i > 0) {
+            fill(r.cost, r.cost + stride, 1e9);
+            fill(r.time, r.time + stride, 0.0);
+            fill(r.fuel, r.fuel + stride, 0.0);
+            fill(r.code, r.code + stride, (unsigned char)0);
+            fill(r.setting, r.setting + stride, (unsigned short)0);
+        }
+        return r;
+    }
+
+    // Упаковывает коды законченной строки (только потоковый режим)
+    void commit_row(int i) {
+        if (!stream) return;
+        const unsigned char* src = row(i).code;
+        unsigned char* dst = &packed[(size_t)i * packed_row_bytes];
+        for (size_t j = 0; j < stride; j++) {
+            dst[j / 4] |= (unsigned char)(src[j] << ((j % 4) * 2));
+        }
+    }
+
+    int code_at(int i, int j) const {
+        if (stream) {
+            unsigned char b = packed[(size_t)i * packed_row_bytes + j / 4];
+            return (b >> ((j % 4) * 2)) & 3;
+        }
+        return codes[(size_t)i * stride + j];
+    }
+
+    // Полные матрицы доступны только в полном режиме
+    int setting_at(int i, int j) const {
+        return settings[(size_t)i * stride + j];
+    }
+
+    double time_at(int i, int j) const {
+        return block[stride * stride + (size_t)i * stride + j];
+    }
+
+    double fuel_at(int i, int j) const {
+        return block[2 * stride * stride + (size_t)i * stride + j];
+    }
+
+    // Матрицы целиком, (n + 1) x (n + 1) по строкам; только полный режим
+    const double* cost_matrix() const {
+        return &block[0];
+    }
+
+    const double* time_matrix() const {
+        return &block[stride * stride];
+    }
+
+    const double* fuel_matrix() const {
+        return &block[2 * stride * stride];
+    }
+
+    const unsigned char* code_matrix() const {
+        return &codes[0];
+    }
+
+    size_t memory_bytes() const {
+        return block.size() * sizeof(double) + codes.size() + settings.size() * sizeof(unsigned short) +
+            packed.size();
+    }
+
+private:
+    int n;
+    size_t stride;
+    bool stream;
+    vector<double> block;
+    vector<unsigned char> codes;
+    vector<unsigned short> settings;
+    vector<unsigned char> packed;
+    size_t packed_row_bytes;
+};
+
+// Предвычисленная физика сетки. Точки атмосферы хранятся для узлов и
+// середин шагов по высоте (индекс 2i - узел i, 2i+1 - середина между i и i+1):
+// именно в них маневры запрашивают плотность, скорость звука, тягу и расход.
+// Все три маневра берут значения отсюда, поэтому во внутреннем цикле ДП
+// нет ни поиска по ATMOS_TABLE, ни pow.
+// continuous - режим двигателей подбирается на каждом участке по решетке
+// settings (search_power); тогда lanes - одна группа с одной дорожкой,
+// в которую записывается лучший режим участка.
+struct GridPhysics {
+    const AircraftModel* aircraft;
+    const UniformAtmosphere* atmosphere;
+    vector<AltitudePoint> altitude;
+    vector<PowerSetting> settings;
+    vector<PowerLanes> lanes;
+    bool continuous;
+};
+
+void build_grid_physics(GridPhysics& physics, const AircraftModel& ac, const UniformAtmosphere& atm,
+    const vector<double>& H_grid, const vector<double>& power_settings, bool continuous) {
+    int n = (int)H_grid.size() - 1;
+    size_t count = 2 * (size_t)n + 1;
+
+    // Атмосфера считается порциями через буферы на стеке,
+    // чтобы повторное построение не выделяло память
+    const size_t chunk = 64;
+    double H_points[chunk], rho[chunk], a_sound[chunk];
+
+    physics.aircraft = &ac;
+    physics.atmosphere = &atm;
+    physics.altitude.resize(count);
+    for (size_t first = 0; first < count; first += chunk) {
+        size_t size = min(chunk, count - first);
+        for (size_t k = 0; k < size; k++) {
+            size_t point = first + k;
+            H_points[k] = point % 2 == 0 ? H_grid[point / 2] : 0.5 * (H_grid[point / 2] + H_grid[point / 2 + 1]);
+        }
+        atmosphere_batch(atm, H_points, size, rho, a_sound);
+
+        for (size_t k = 0; k < size; k++) {
+            AltitudePoint& p = physics.altitude[first + k];
+            fill_altitude_factors(ac, atm, p, H_points[k]);
+            p.rho = rho[k];
+            p.a_sound = a_sound[k];
+            p.wind = atmosphere_wind(atm, H_points[k]);
+        }
+    }
+
+    physics.settings.resize(power_settings.size());
+    for (size_t ps = 0; ps < power_settings.size(); ps++) {
+        physics.settings[ps] = make_power_setting(power_settings[ps]);
+    }
+
+    physics.continuous = continuous;
+    physics.lanes.clear();
+    if (continuous) {
+        physics.lanes.push_back(make_power_lanes(physics.settings, 0));
+        physics.lanes[0].count = 1;
+        return;
+    }
+    for (size_t first = 0; first < physics.settings.size(); first += PS_LANES) {
+        physics.lanes.push_back(make_power_lanes(physics.settings, first));
+    }
+}
+
+struct EdgeCostTable;
+
+struct SweepGrid {
+    const GridPhysics* physics;
+    const vector<double>* V_grid_ms;
+    double mass;
+    double max_vy_factor;
+    OptimizationCriterion criterion;
+    double cost_index;
+    const EdgeCostTable* edges;
+};
+
+// Стоимость участка по критерию. Политика подставляется в шаблоны обхода,
+// поэтому во внутреннем цикле ДП критерий не выбирается во время выполнения.
+struct TimeObjective {
+    double operator()(double time, double fuel) const {
+        (void)fuel;
+        return time;
+    }
+};
+
+struct FuelObjective {
+    double operator()(double time, double fuel) const {
+        (void)time;
+        return fuel;
+    }
+};
+
+// Индекс стоимости CI, кг/мин: минута полета стоит CI кг топлива
+struct CostIndexObjective {
+    double ci_per_s;
+
+    double operator()(double time, double fuel) const {
+        return time * ci_per_s + fuel;
+    }
+};
+
+// Вызывает body с политикой, соответствующей критерию сетки
+template <class Body>
+void with_objective(const SweepGrid& g, Body body) {
+    if (g.criterion == MIN_TIME) {
+        body(TimeObjective());
+    }
+    else if (g.criterion == MIN_FUEL) {
+        body(FuelObjective());
+    }
+    else {
+        CostIndexObjective objective;
+        objective.ci_per_s = g.cost_index / 60.0;
+        body(objective);
+    }
+}
+
+// Узел, из которого маневр приводит в (i, j)
+void maneuver_source(int maneuver, int i, int j, int& pi, int& pj) {
+    pi = (maneuver == RAZGON) ? i : i - 1;
+    pj = (maneuver == PODIEM) ? j : j - 1;
+}
+
+// Непрерывный режим двигателей: лучший по критерию режим участка на
+// решетке lattice (возрастающие значения). kernel(lanes, out) считает
+// участок для PS_LANES режимов сразу, поэтому за раунд проверяются
+// PS_LANES точек: сначала концы и трети отрезка, затем отрезок между
+// соседями лучшей точки делится на пять частей. Стоимость участка по режиму
+// считается унимодальной; когда в отрезке остается не больше PS_LANES
+// узлов, проверяются все. Точки сравниваются по (стоимость, топливо):
+// при равной стоимости (у MIN_TIME - на кинематических пределах) отрезок
+// сужается к более экономному режиму. Поиск прекращается раньше, если
+// все точки раунда недопустимы или равны и по стоимости, и по топливу.
+// Результат - в дорожке 0 out, возвращается индекс режима или -1.
+template <class Objective, class Kernel>
+int search_power(const vector<PowerSetting>& lattice, const Objective& objective, Kernel kernel,
+    SegmentLanes& out) {
+    const double INF = numeric_limits<double>::infinity();
+    int best = -1;
+    double best_cost = INF;
+    SegmentData best_seg;
+    best_seg.valid = false;
+    best_seg.time = 1e9;
+    best_seg.fuel = 1e9;
+
+    auto evaluate = [&](const int* index, int count, double* cost, double* fuel) {
+        PowerLanes lanes;
+        lanes.count = count;
+        for (int k = 0; k < PS_LANES; k++) {
+            const PowerSetting& ps = lattice[index[k < count ? k : 0]];
+            lanes.value[k] = ps.value;
+            lanes.sfc_regime_factor[k] = ps.sfc_regime_factor;
+        }
+        SegmentLanes lane_out;
+        kernel(lanes, lane_out);
+        for (int k = 0; k < count; k++) {
+            cost[k] = lane_out.valid[k] ? objective(lane_out.time[k], lane_out.fuel[k]) : INF;
+            fuel[k] = lane_out.valid[k] ? lane_out.fuel[k] : INF;
+            if (cost[k] == INF) continue;
+            if (best < 0 || cost[k] < best_cost || (cost[k] == best_cost && lane_out.fuel[k] < best_seg.fuel)) {
+                best = index[k];
+                best_cost = cost[k];
+                best_seg = lane_segment(lane_out, k);
+            }
+        }
+    };
+
+    // Точки раунда по возрастанию индекса: концы отрезка и PS_LANES проб
+    int point[PS_LANES + 2];
+    double cost[PS_LANES + 2];
+    double fuel[PS_LANES + 2];
+    int last = (int)lattice.size() - 1;
+    int count;
+    if (last < PS_LANES) {
+        for (int k = 0; k <= last; k++) point[k] = k;
+        evaluate(point, last + 1, cost, fuel);
+        count = 0;
+    }
+    else {
+        for (int k = 0; k < PS_LANES; k++) point[k] = last * k / (PS_LANES - 1);
+        evaluate(point, PS_LANES, cost, fuel);
+        count = PS_LANES;
+    }
+
+    while (count > 0) {
+        int b = 0;
+        bool flat = true;
+        for (int k = 1; k < count; k++) {
+            if (cost[k] != cost[0] || fuel[k] != fuel[0]) flat = false;
+            if (cost[k] < cost[b] || (cost[k] == cost[b] && fuel[k] < fuel[b])) b = k;
+        }
+        if (flat) break;
+
+        int lo = b > 0 ? b - 1 : b;
+        int hi = b < count - 1 ? b + 1 : b;
+        int lo_point = point[lo], hi_point = point[hi];
+        double lo_cost = cost[lo], hi_cost = cost[hi];
+        double lo_fuel = fuel[lo], hi_fuel = fuel[hi];
+        int inner = hi_point - lo_point - 1;
+        if (inner <= 0) break;
+
+        int probe[PS_LANES];
+        if (inner <= PS_LANES) {
+            for (int k = 0; k < inner; k++) probe[k] = lo_point + 1 + k;
+            evaluate(probe, inner, cost + 1, fuel + 1);
+            break;
+        }
+        for (int k = 0; k < PS_LANES; k++) probe[k] = lo_point + (hi_point - lo_point) * (k + 1) / (PS_LANES + 1);
+        evaluate(probe, PS_LANES, cost + 1, fuel + 1);
+        point[0] = lo_point;
+        cost[0] = lo_cost;
+        fuel[0] = lo_fuel;
+        for (int k = 0; k < PS_LANES; k++) point[k + 1] = probe[k];
+        point[PS_LANES + 1] = hi_point;
+        cost[PS_LANES + 1] = hi_cost;
+        fuel[PS_LANES + 1] = hi_fuel;
+        count = PS_LANES + 2;
+    }
+
+    for (int k = 0; k < PS_LANES; k++) {
+        out.time[k] = 1e9;
+        out.fuel[k] = 1e9;
+        out.valid[k] = false;
+    }
+    out.time[0] = best_seg.time;
+    out.fuel[0] = best_seg.fuel;
+    out.valid[0] = best_seg.valid;
+    return best;
+}
+
+// Участок, заканчивающийся в узле (i, j), для режимов lanes;
+// mass - масса самолета в начале участка
+void evaluate_edge_power(const SweepGrid& g, int i, int j, int maneuver, const PowerLanes& lanes, double mass,
+    SegmentLanes& out) {
+    const AircraftModel& ac = *g.physics->aircraft;
+    const vector<AltitudePoint>& alt = g.physics->altitude;
+    const vector<double>& V_grid_ms = *g.V_grid_ms;
+
+    if (maneuver == RAZGON) {
+        calculate_razgon_lanes(ac, alt[2 * i], V_grid_ms[j - 1], V_grid_ms[j], mass, lanes, out);
+    }
+    else if (maneuver == PODIEM) {
+        calculate_podiem_lanes(ac, alt[2 * i - 2], alt[2 * i], alt[2 * i - 1], V_grid_ms[j], mass,
+            lanes, g.max_vy_factor, out);
+    }
+    else {
+        calculate_razgon_podiem_lanes(ac, alt[2 * i - 2], alt[2 * i], alt[2 * i - 1], V_grid_ms[j - 1], V_grid_ms[j],
+            mass, lanes, g.max_vy_factor, false, out);
+    }
+}
+
+// Участок для группы режимов physics.lanes[block]; в непрерывном режиме -
+// лучший по критерию сетки режим решетки в дорожке 0. Возвращает номер
+// режима дорожки 0 в physics.settings (у дорожки k - на k больше).
+int evaluate_edge_lanes(const SweepGrid& g, int i, int j, int maneuver, size_t block, double mass,
+    SegmentLanes& out) {
+    if (!g.physics->continuous) {
+        evaluate_edge_power(g, i, j, maneuver, g.physics->lanes[block], mass, out);
+        return (int)block * PS_LANES;
+    }
+    int best = -1;
+    with_objective(g, [&](const auto& objective) {
+        best = search_power(g.physics->settings, objective, [&](const PowerLanes& lanes, SegmentLanes& lane_out) {
+            evaluate_edge_power(g, i, j, maneuver, lanes, mass, lane_out);
+        }, out);
+    });
+    return max(best, 0);
+}
+
+// Предвычисленные участки всех ребер сетки при массе g.mass: столбцы
+// времени и топлива по одному на режим двигателей сетки (хранятся в
+// EdgeCache). Стоимость по любому критерию получается из времени и
+// топлива, поэтому таблица служит нескольким решениям на той же сетке.
+struct EdgeCostTable {
+    int n;
+    vector<const double*> time;
+    vector<const double*> fuel;
+
+    size_t index(int i, int j, int maneuver) const {
+        return ((size_t)i * (n + 1) + j) * 3 + (maneuver - 1);
+    }
+};
+
+size_t edge_column_size(int n) {
+    return ((size_t)n + 1) * ((size_t)n + 1) * 3;
+}
+
+// Объем столбцов времени и топлива одного режима, байт
+double edge_column_bytes(int n) {
+    return 2.0 * sizeof(double) * (double)edge_column_size(n);
+}
+
+// Участок из таблицы, если она есть, иначе - расчет при массе g.mass.
+// Недействительные участки хранятся со временем 1e9, как их помечают ядра.
+// Возвращает номер режима дорожки 0, как evaluate_edge_lanes.
+inline int edge_lanes(const SweepGrid& g, int i, int j, int maneuver, size_t block, SegmentLanes& out) {
+    if (g.edges != NULL) {
+        const EdgeCostTable& table = *g.edges;
+        size_t idx = table.index(i, j, maneuver);
+        size_t first = block * PS_LANES;
+        int count = g.physics->lanes[block].count;
+        for (int k = 0; k < PS_LANES; k++) {
+            bool lane = k < count;
+            out.time[k] = lane ? table.time[first + k][idx] : 1e9;
+            out.fuel[k] = lane ? table.fuel[first + k][idx] : 1e9;
+            out.valid[k] = out.time[k] < 1e9;
+        }
+        return (int)first;
+    }
+    return evaluate_edge_lanes(g, i, j, maneuver, block, g.mass, out);
+}
+
+// Лучший по критерию режим двигателей для участка, заканчивающегося в (i, j);
+// setting - его номер в physics.settings
+template <class Objective>
+SegmentData best_edge(const SweepGrid& g, int i, int j, int maneuver, const Objective& objective, int& setting) {
+    SegmentData best;
+    best.valid = false;
+    best.time = 1e9;
+    best.fuel = 1e9;
+    setting = 0;
+
+    for (size_t block = 0; block < g.physics->lanes.size(); block++) {
+        SegmentLanes lanes;
+        int first = edge_lanes(g, i, j, maneuver, block, lanes);
+
+        for (int k = 0; k < g.physics->lanes[block].count; k++) {
+            SegmentData seg = lane_segment(lanes, k);
+            if (!seg.valid) continue;
+
+            if (!best.valid || objective(seg.time, seg.fuel) < objective(best.time, best.fuel)) {
+                best = seg;
+                setting = first + k;
+            }
+        }
+    }
+    return best;
+}
+
+template <class Objective>
+void accept_candidate(const DPRow& src, int sj, DPRow& dst, int dj, const SegmentData& seg, int setting,
+    const Objective& objective, ManeuverType maneuver) {
+    if (!seg.valid) return;
+
+    double new_cost = src.cost[sj] + objective(seg.time, seg.fuel);
+
+    if (new_cost < dst.cost[dj]) {
+        dst.cost[dj] = new_cost;
+        dst.time[dj] = src.time[sj] + seg.time;
+        dst.fuel[dj] = src.fuel[sj] + seg.fuel;
+        dst.code[dj] = (unsigned char)maneuver;
+        dst.setting[dj] = (unsigned short)setting;
+    }
+}
+
+// Кандидаты всех режимов одного маневра в порядке режимов;
+// first_setting - номер режима дорожки 0
+template <class Objective>
+void accept_lanes(const DPRow& src, int sj, DPRow& dst, int dj, const SegmentLanes& lanes, int count,
+    int first_setting, const Objective& objective, ManeuverType maneuver) {
+    for (int k = 0; k < count; k++) {
+        accept_candidate(src, sj, dst, dj, lane_segment(lanes, k), first_setting + k, objective, maneuver);
+    }
+}
+
+template <class Objective>
+void offer_edge(const DPRow& src, int sj, DPRow& dst, const SweepGrid& g, int i, int j, ManeuverType maneuver,
+    const Objective& objective) {
+    for (size_t block = 0; block < g.physics->lanes.size(); block++) {
+        SegmentLanes lanes;
+        int first = edge_lanes(g, i, j, maneuver, block, lanes);
+        accept_lanes(src, sj, dst, j, lanes, g.physics->lanes[block].count, first, objective, maneuver);
+    }
+}
+
+// Переходы в (i, j) из предыдущей строки: разгон с подъемом и подъем
+template <class Objective>
+void relax_from_below(const DPRow& below, DPRow& cur, const SweepGrid& g, int i, int j,
+    const Objective& objective) {
+    if (i > 0 && j > 0 && below.cost[j - 1] < 1e9) {
+        offer_edge(below, j - 1, cur, g, i, j, RAZGON_PODIEM, objective);
+    }
+
+    if (i > 0 && below.cost[j] < 1e9) {
+        offer_edge(below, j, cur, g, i, j, PODIEM, objective);
+    }
+}
+
+// Узел (i, j) получает значения из (i-1, j-1), (i-1, j) и (i, j-1).
+// Кандидаты перебираются в том же порядке, в каком их предлагал построчный
+// обход "вперед" (сначала разгон с подъемом, затем подъем, затем разгон),
+// поэтому результат побитово совпадает с последовательным вариантом.
+template <class Objective>
+void relax_cell(const DPRow& below, DPRow& cur, const SweepGrid& g, int i, int j, const Objective& objective) {
+    relax_from_below(below, cur, g, i, j, objective);
+
+    if (j > 0 && cur.cost[j - 1] < 1e9) {
+        offer_edge(cur, j - 1, cur, g, i, j, RAZGON, objective);
+    }
+}
+
+DPRow row_below(DPStore& store, int i) {
+    if (i > 0) return store.row(i - 1);
+    DPRow none = { NULL, NULL, NULL, NULL, NULL };
+    return none;
+}
+
+template <class Objective>
+void sweep_serial(DPStore& store, const SweepGrid& g, int n, const Objective& objective) {
+    for (int i = 0; i <= n; i++) {
+        DPRow cur = store.begin_row(i);
+        DPRow below = row_below(store, i);
+        for (int j = 0; j <= n; j++) {
+            relax_cell(below, cur, g, i, j, objective);
+        }
+        store.commit_row(i);
+    }
+}
+
+// Волновой обход: все узлы антидиагонали i + j = d независимы друг от друга
+// и зависят только от диагоналей d-1 и d-2, поэтому считаются параллельно.
+template <class Objective>
+void sweep_wavefront(DPStore& store, const SweepGrid& g, int n, ThreadPool& pool, const Objective& objective) {
+    for (int d = 0; d <= 2 * n; d++) {
+        int i_begin = max(0, d - n);
+        int i_end = min(d, n);
+        pool.parallel_for(i_end - i_begin + 1, 16, [&](int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                int i = i_begin + k;
+                DPRow cur = store.row(i);
+                DPRow below = row_below(store, i);
+                relax_cell(below, cur, g, i, d - i, objective);
+            }
+        });
+    }
+}
+
+// Разгоны строки потокового обхода: дорожки по (j, блок режимов)
+struct StreamingRazgon {
+    vector<SegmentLanes> segs;
+    vector<int> first;
+};
+
+// Потоковый обход по строкам для режима двух строк.
+// Переходы из предыдущей строки и физика разгонов считаются параллельно,
+// затем цепочка разгонов вдоль строки применяется последовательно
+// в исходном порядке кандидатов.
+template <class Objective>
+void sweep_streaming(DPStore& store, const SweepGrid& g, int n, ThreadPool& pool, StreamingRazgon& razgon,
+    const Objective& objective) {
+    size_t blocks = g.physics->lanes.size();
+    razgon.segs.resize((size_t)(n + 1) * blocks);
+    razgon.first.resize((size_t)(n + 1) * blocks);
+    vector<SegmentLanes>& razgon_segs = razgon.segs;
+    vector<int>& razgon_first = razgon.first;
+
+    for (int i = 0; i <= n; i++) {
+        DPRow cur = store.begin_row(i);
+        DPRow below = row_below(store, i);
+
+        pool.parallel_for(n + 1, 64, [&](int begin, int end) {
+            for (int j = begin; j < end; j++) {
+                relax_from_below(below, cur, g, i, j, objective);
+                if (j == 0) continue;
+                for (size_t block = 0; block < blocks; block++) {
+                    razgon_first[j * blocks + block] = edge_lanes(g, i, j, RAZGON, block, razgon_segs[j * blocks + block]);
+                }
+            }
+        });
+
+        for (int j = 1; j <= n; j++) {
+            if (cur.cost[j - 1] >= 1e9) continue;
+            for (size_t block = 0; block < blocks; block++) {
+                accept_lanes(cur, j - 1, cur, j, razgon_segs[j * blocks + block],
+                    g.physics->lanes[block].count, razgon_first[j * blocks + block], objective, RAZGON);
+            }
+        }
+        store.commit_row(i);
+    }
+}
+
+// Коридор по строкам сетки: в строке i считаются только узлы lo[i]..hi[i]
+struct Corridor {
+    vector<int> lo;
+    vector<int> hi;
+};
+
+// Обход внутри коридора; узлы вне его остаются недостижимыми
+template <class Objective>
+void sweep_corridor(DPStore& store, const SweepGrid& g, int n, const Corridor& corridor,
+    const Objective& objective) {
+    for (int i = 0; i <= n; i++) {
+        DPRow cur = store.begin_row(i);
+        DPRow below = row_below(store, i);
+        for (int j = corridor.lo[i]; j <= corridor.hi[i]; j++) {
+            relax_cell(below, cur, g, i, j, objective);
+        }
+        store.commit_row(i);
+    }
+}
+
+// Коридор сетки fine_n вокруг пути nodes сетки coarse_n: каждый участок пути
+// покрывается прямоугольником в координатах новой сетки, расширенным
+// на halfwidth узлов во все стороны
+void build_corridor(const vector<pair<int, int> >& nodes, int coarse_n, int fine_n, int halfwidth,
+    Corridor& corridor) {
+    corridor.lo.assign(fine_n + 1, fine_n);
+    corridor.hi.assign(fine_n + 1, 0);
+    double scale = (double)fine_n / coarse_n;
+
+    for (size_t k = 1; k < nodes.size(); k++) {
+        int i0 = max(0, (int)floor(nodes[k - 1].first * scale) - halfwidth);
+        int i1 = min(fine_n, (int)ceil(nodes[k].first * scale) + halfwidth);
+        int j0 = max(0, (int)floor(nodes[k - 1].second * scale) - halfwidth);
+        int j1 = min(fine_n, (int)ceil(nodes[k].second * scale) + halfwidth);
+        for (int i = i0; i <= i1; i++) {
+            corridor.lo[i] = min(corridor.lo[i], j0);
+            corridor.hi[i] = max(corridor.hi[i], j1);
+        }
+    }
+}
+
+double corridor_cells(const Corridor& corridor) {
+    double cells = 0.0;
+    for (size_t i = 0; i < corridor.lo.size(); i++) {
+        cells += max(0, corridor.hi[i] - corridor.lo[i] + 1);
+    }
+    return cells;
+}
+
+bool corridor_is_full(const Corridor& corridor) {
+    int n = (int)corridor.lo.size() - 1;
+    for (int i = 0; i <= n; i++) {
+        if (corridor.lo[i] > 0 || corridor.hi[i] < n) return false;
+    }
+    return true;
+}
+
+// Расчет столбцов таблицы ребер для режимов сетки с time_cols[s] != NULL;
+// строки сетки считаются параллельно
+void build_edge_columns(const SweepGrid& g, int n, const vector<double*>& time_cols,
+    const vector<double*>& fuel_cols, ThreadPool* pool) {
+    EdgeCostTable layout;
+    layout.n = n;
+    size_t blocks = g.physics->lanes.size();
+
+    function<void(int, int)> body = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            for (int j = 0; j <= n; j++) {
+                for (int maneuver = RAZGON; maneuver <= RAZGON_PODIEM; maneuver++) {
+                    size_t idx = layout.index(i, j, maneuver);
+                    int pi, pj;
+                    maneuver_source(maneuver, i, j, pi, pj);
+
+                    for (size_t block = 0; block < blocks; block++) {
+                        int count = g.physics->lanes[block].count;
+                        bool needed = false;
+                        for (int k = 0; k < count; k++) {
+                            if (time_cols[block * PS_LANES + k] != NULL) needed = true;
+                        }
+                        if (!needed) continue;
+
+                        SegmentLanes lanes;
+                        if (pi < 0 || pj < 0) reject_lanes(lanes);
+                        else evaluate_edge_lanes(g, i, j, maneuver, block, g.mass, lanes);
+
+                        for (int k = 0; k < count; k++) {
+                            size_t s = block * PS_LANES + k;
+                            if (time_cols[s] == NULL) continue;
+                            time_cols[s][idx] = lanes.valid[k] ? lanes.time[k] : 1e9;
+                            fuel_cols[s][idx] = lanes.valid[k] ? lanes.fuel[k] : 1e9;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    if (pool != NULL) pool->parallel_for(n + 1, 1, body);
+    else body(0, n + 1);
+}
+
+// Поиск по первому наилучшему (A*) на графе состояний (H, V). В отличие
+// от обхода всей сетки раскрываются только узлы с f = g + h не больше
+// стоимости пути в (N, N), а участки считаются лениво - при раскрытии узла.
+// Переходы задаются шаблоном (di, dj); маневр определяется знаками
+// изменения высоты и скорости, поэтому при allow_reverse доступны
+// торможение, снижение и обмен скорости на высоту. Граф с обратными
+// переходами содержит циклы; стоимости участков положительны, поэтому
+// A* с согласованной оценкой раскрывает каждый узел один раз.
+// Поиск нужен ради немонотонных переходов и длинных участков, а не ради
+// скорости: почти все монотонные пути по сетке близки к оптимуму по
+// стоимости, и даже при оценке в 2% от точной A* раскрывает больше
+// половины узлов (N = 80), а на узел тратит больше обхода.
+
+// Оценки для эвристики: наибольшие темпы набора (снижения) высоты и
+// разгона (торможения) на отдельных маневрах и на разгоне с подъемом,
+// наименьший секундный расход по всей сетке.
+//
+// По строкам и столбцам (без обратных переходов): полоса высоты k (между
+// строками k и k + 1) проходится подъемом не быстрее и не дешевле
+// оценки по наибольшей скороподъемности в точках середины участков,
+// которые ее накрывают; столбец скорости c - разгоном не быстрее оценки
+// по наибольшему dV/dt на всех высотах. Подъем и разгон идут подряд,
+// поэтому их оценки складываются; совмещает их только разгон с подъемом
+// на одну ячейку - каждый такой участок заменяет одну полосу и один
+// столбец. climb_* и accel_* - суффиксные суммы по полосам и столбцам,
+// shortcut_* - суффиксные суммы наибольшего выигрыша от r таких участков
+// (по префиксным максимумам оценок, так оценка остается согласованной).
+// С обратными переходами скорость меняется и обменом энергии, поэтому
+// остаются только полосы высоты, которые проходятся хотя бы один раз.
+struct SearchBounds {
+    double vy_max;
+    double accel_max;
+    double combined_vy_max;
+    double combined_accel_max;
+    double fuel_flow_min;
+    int n;
+    vector<double> climb_time;
+    vector<double> climb_fuel;
+    vector<double> accel_time;
+    vector<double> accel_fuel;
+    vector<double> shortcut_time;
+    vector<double> shortcut_fuel;
+};
+
+// Скорость в точке q полусетки: узел q / 2 или середина между узлами
+inline double half_grid_speed(const vector<double>& V, int q) {
+    return q % 2 == 0 ? V[q / 2] : 0.5 * (V[q / 2] + V[q / 2 + 1]);
+}
+
+// Строчные оценки SearchBounds для шаблона с дальностью reach. Участок на
+// несколько ячеек считается в середине: по высоте - точка окна
+// [2k - reach + 2, 2k + reach] (для reach = 1 - середина полосы), по
+// скорости - так же по точкам полусетки; сдвиг ветра на участке не больше
+// наибольшего по полосам. Проверки области полета не учитываются - оценка
+// от этого только слабее.
+void fill_row_bounds(SearchBounds& bounds, const SweepGrid& g, int n, int reach, bool allow_reverse,
+    double power_max, double power_min, double regime_min) {
+    const AircraftModel& ac = *g.physics->aircraft;
+    const vector<AltitudePoint>& alt = g.physics->altitude;
+    const vector<double>& V = *g.V_grid_ms;
+    const double INF = 1e18;
+
+    double shear_max = 0.0;
+    for (int k = 0; k < n; k++) {
+        shear_max = max(shear_max, (alt[2 * k + 2].wind - alt[2 * k].wind) / (alt[2 * k + 2].H - alt[2 * k].H));
+    }
+
+    double sin_theta_max = sin(MAX_CLIMB_ANGLE / DEG_TO_RAD);
+    double vy_limit = MAX_VERTICAL_SPEED * g.max_vy_factor;
+    double vc = bounds.combined_vy_max;
+
+    // Физика в точке (p, q): избыток тяги на наибольшем режиме и c_p при
+    // наименьшем множителе режима
+    auto excess = [&](int p, int q, double& V_ms, double& P_max, double& P_hi, double& X, double& c_p) {
+        const AltitudePoint& h = alt[p];
+        V_ms = half_grid_speed(V, q);
+        P_max = total_thrust(ac, h, V_ms);
+        double dynamic = 0.5 * h.rho * V_ms * V_ms;
+        X = Cx_alpha(ac, calculate_alpha(ac, h, V_ms, g.mass, P_max)) * dynamic * ac.wing_area;
+        P_hi = P_max * power_max;
+        double M = V_ms / h.a_sound;
+        c_p = ac.cp_base * regime_min * h.sfc_altitude_factor * (1.0 + ac.sfc_mach * max(0.0, M - 0.5)) / 9.81;
+        return P_hi - X;
+    };
+
+    // По точкам высоты: наибольшая скороподъемность и наименьший расход на
+    // метр подъема (P / Vy не меньше P / vy_limit и m g P / (V (P - X)),
+    // второе убывает по P), наименьшее c_p P_min - тяга монотонна по Маху,
+    // ее минимум по скоростям на краю сетки, множитель c_p по Маху >= 1
+    vector<double> vy_point(alt.size(), 0.0), fuel_point(alt.size(), INF), thrust_point(alt.size(), INF);
+    for (int p = 1; p <= 2 * n - 1; p++) {
+        if (reach == 1 && p % 2 == 0) continue;
+        const AltitudePoint& h = alt[p];
+        thrust_point[p] = ac.cp_base * regime_min * h.sfc_altitude_factor / 9.81 * power_min *
+            min(total_thrust(ac, h, V[0]), total_thrust(ac, h, V[n]));
+
+        for (int q = 0; q <= 2 * n; q++) {
+            if (reach == 1 && q % 2 != 0) continue;
+            if (half_grid_speed(V, q) * 3.6 < MIN_CLIMB_SPEED_KMH) continue;
+
+            double V_ms, P_max, P_hi, X, c_p;
+            if (excess(p, q, V_ms, P_max, P_hi, X, c_p) <= 0) continue;
+
+            double g_climb = reach == 1 ? climb_gravity(alt[p - 1], alt[p + 1], V_ms) : G - V_ms * shear_max;
+            double Vy = g_climb > 0 ? min(V_ms * min((P_hi - X) / (g.mass * g_climb), sin_theta_max), vy_limit) : vy_limit;
+            vy_point[p] = max(vy_point[p], Vy);
+
+            double per_meter = max(max(P_max * power_min, X) / vy_limit,
+                g_climb > 0 ? g.mass * g_climb * P_hi / (V_ms * (P_hi - X)) : 0.0);
+            fuel_point[p] = min(fuel_point[p], c_p * per_meter / 3600.0);
+        }
+    }
+
+    // По точкам полусетки скорости: наибольшее dV/dt = (P cos(alpha) - X) / m
+    // и наименьший расход на 1 м/с разгона c_p m P / (P - X) по всем высотам
+    // участка разгона (строки; для reach > 1 - и середины)
+    vector<double> accel_point(2 * n + 1, 0.0), accel_fuel_point(2 * n + 1, INF);
+    if (!allow_reverse) {
+        for (int q = 1; q <= 2 * n - 1; q++) {
+            if (reach == 1 && q % 2 == 0) continue;
+            for (int p = 0; p <= 2 * n; p++) {
+                if (reach == 1 && p % 2 != 0) continue;
+
+                double V_ms, P_max, P_hi, X, c_p;
+                double surplus = excess(p, q, V_ms, P_max, P_hi, X, c_p);
+                if (surplus <= 0) continue;
+
+                accel_point[q] = max(accel_point[q], surplus / g.mass);
+                accel_fuel_point[q] = min(accel_fuel_point[q], c_p * g.mass * P_hi / surplus / 3600.0);
+            }
+        }
+    }
+
+    double trade_vy = max(vy_limit, vc);
+    double shortcut_min_time = INF, shortcut_thrust = INF;
+    vector<double> band_time(n), band_fuel(n), column_time(n, 0.0), column_fuel(n, 0.0);
+    for (int k = 0; k < n; k++) {
+        int lo = max(1, 2 * k - reach + 2), hi = min(2 * n - 1, 2 * k + reach);
+        double vy = 0.0, fuel = INF, thrust = INF, accel = 0.0, accel_fuel = INF;
+        for (int p = lo; p <= hi; p++) {
+            vy = max(vy, vy_point[p]);
+            fuel = min(fuel, fuel_point[p]);
+            thrust = min(thrust, thrust_point[p]);
+            accel = max(accel, accel_point[p]);
+            accel_fuel = min(accel_fuel, accel_fuel_point[p]);
+        }
+
+        // Полосу, где подъема нет, проходит только разгон с подъемом:
+        // ее оценка подъема - любая, берется та же, что у него
+        double dH = alt[2 * k + 2].H - alt[2 * k].H;
+        double short_time = dH / vc;
+        double short_fuel = dH * thrust / (vc * 3600.0);
+        if (allow_reverse) {
+            band_time[k] = dH / max(vy, trade_vy);
+            band_fuel[k] = min(min(dH * fuel, short_fuel), dH * thrust / (trade_vy * 3600.0));
+            continue;
+        }
+        band_time[k] = vy > 0 ? dH / vy : short_time;
+        band_fuel[k] = fuel < INF ? dH * fuel : short_fuel;
+
+        double dV = V[k + 1] - V[k];
+        double shortcut_time = max(short_time, dV / (15.0 / 3.6));
+        column_time[k] = accel > 0 ? dV / accel : shortcut_time;
+        column_fuel[k] = accel_fuel < INF ? dV * accel_fuel : 0.0;
+        shortcut_min_time = min(shortcut_min_time, shortcut_time);
+        shortcut_thrust = min(shortcut_thrust, thrust);
+    }
+
+    // Выигрыш r-го участка разгона с подъемом - сумма r-х с конца
+    // префиксных максимумов оценок полосы и столбца минус его время;
+    // выигрыши не возрастают, отрицательные отбрасываются
+    vector<double> shortcut_time(n, 0.0), shortcut_fuel(n, 0.0);
+    if (!allow_reverse) {
+        double shortcut_fuel_min = shortcut_thrust * shortcut_min_time / 3600.0;
+        double band_time_max = 0.0, band_fuel_max = 0.0, column_time_max = 0.0, column_fuel_max = 0.0;
+        for (int k = 0; k < n; k++) {
+            band_time_max = max(band_time_max, band_time[k]);
+            band_fuel_max = max(band_fuel_max, band_fuel[k]);
+            column_time_max = max(column_time_max, column_time[k]);
+            column_fuel_max = max(column_fuel_max, column_fuel[k]);
+            shortcut_time[k] = max(0.0, band_time_max + column_time_max - shortcut_min_time);
+            shortcut_fuel[k] = max(0.0, band_fuel_max + column_fuel_max - shortcut_fuel_min);
+        }
+    }
+
+    bounds.n = n;
+    bounds.climb_time.assign(n + 1, 0.0);
+    bounds.climb_fuel.assign(n + 1, 0.0);
+    bounds.accel_time.assign(n + 1, 0.0);
+    bounds.accel_fuel.assign(n + 1, 0.0);
+    bounds.shortcut_time.assign(n + 1, 0.0);
+    bounds.shortcut_fuel.assign(n + 1, 0.0);
+    for (int k = n - 1; k >= 0; k--) {
+        bounds.climb_time[k] = bounds.climb_time[k + 1] + band_time[k];
+        bounds.climb_fuel[k] = bounds.climb_fuel[k + 1] + band_fuel[k];
+        bounds.accel_time[k] = bounds.accel_time[k + 1] + column_time[k];
+        bounds.accel_fuel[k] = bounds.accel_fuel[k + 1] + column_fuel[k];
+        bounds.shortcut_time[k] = bounds.shortcut_time[k + 1] + shortcut_time[k];
+        bounds.shortcut_fuel[k] = bounds.shortcut_fuel[k + 1] + shortcut_fuel[k];
+    }
+}
+
+SearchBounds make_search_bounds(const SweepGrid& g, int n, int reach, bool allow_reverse) {
+    const vector<AltitudePoint>& alt = g.physics->altitude;
+    const vector<PowerSetting>& settings = g.physics->settings;
+
+    double thrust_factor_max = 0.0, thrust_factor_min = 1e9, sfc_altitude_min = 1e9;
+    for (size_t k = 0; k < alt.size(); k++) {
+        thrust_factor_max = max(thrust_factor_max, alt[k].thrust_altitude_factor);
+        thrust_factor_min = min(thrust_factor_min, alt[k].thrust_altitude_factor);
+        sfc_altitude_min = min(sfc_altitude_min, alt[k].sfc_altitude_factor);
+    }
+
+    double power_max = 0.0, power_min = 1e9, regime_min = 1e9;
+    for (size_t s = 0; s < settings.size(); s++) {
+        power_max = max(power_max, settings[s].value);
+        power_min = min(power_min, settings[s].value);
+        regime_min = min(regime_min, settings[s].sfc_regime_factor);
+    }
+    if (allow_reverse) {
+        PowerSetting idle = make_power_setting(IDLE_POWER);
+        power_min = min(power_min, idle.value);
+        regime_min = min(regime_min, idle.sfc_regime_factor);
+    }
+
+    // Тяга: множитель по Маху в thrust_single лежит в [mach0, mach_max]
+    const AircraftModel& ac = *g.physics->aircraft;
+    double engines = ac.engine_count * (ac.thrust_percent / 100.0);
+    double thrust_max = ac.thrust_sea * ac.thrust_mach_max * thrust_factor_max * engines * power_max;
+    double thrust_min = ac.thrust_sea * ac.thrust_mach0 * thrust_factor_min * engines * power_min;
+
+    SearchBounds bounds;
+    // Подъем ограничен max_vy_limit, разгон - тягой P / m; разгон с подъемом
+    // длится не меньше dH / 5 и dV / 15 км/ч в секунду. Обмен энергии
+    // меняет высоту с темпом до max_vy_limit при той же скорости разгона,
+    // поэтому с обратными переходами совместный темп по высоте - не меньше vy_max.
+    bounds.vy_max = MAX_VERTICAL_SPEED * g.max_vy_factor;
+    bounds.accel_max = thrust_max / g.mass;
+    bounds.combined_vy_max = min(5.0, 1.2 * MAX_VERTICAL_SPEED * g.max_vy_factor);
+    bounds.combined_accel_max = 15.0 / 3.6;
+    if (allow_reverse) {
+        bounds.vy_max = max(bounds.vy_max, MAX_VERTICAL_SPEED);
+        bounds.accel_max = max(bounds.accel_max, MAX_DECELERATION);
+        bounds.combined_vy_max = max(bounds.combined_vy_max, bounds.vy_max);
+    }
+    bounds.fuel_flow_min = ac.cp_base * regime_min * sfc_altitude_min / 9.81 * thrust_min / 3600.0;
+    fill_row_bounds(bounds, g, n, reach, allow_reverse, power_max, power_min, regime_min);
+    return bounds;
+}
+
+// Нижняя оценка стоимости пути от (H, V) до (H_f, V_f). Время любого пути
+// не меньше минимума t_b + (dH - vc t_b) / vy + (dV - ac t_b) / a по времени
+// t_b разгонов с подъемом (остаток высоты и скорости набирается отдельными
+// маневрами с предельными темпами); минимум кусочно-линейной функции
+// достигается в одной из точек излома. Топливо не меньше минимального
+// расхода за это время. Оценка согласована: на любом участке она убывает
+// не больше стоимости участка (проверка - --astar-check, сравнение
+// с поиском без оценки).
+double search_time_bound(const SearchBounds& bounds, double dH, double dV_ms) {
+    dH = fabs(dH);
+    dV_ms = fabs(dV_ms);
+    double breaks[3] = { 0.0, dH / bounds.combined_vy_max, dV_ms / bounds.combined_accel_max };
+
+    double time = 1e18;
+    for (int k = 0; k < 3; k++) {
+        double t_b = breaks[k];
+        double rest = t_b + max(0.0, dH - bounds.combined_vy_max * t_b) / bounds.vy_max +
+            max(0.0, dV_ms - bounds.combined_accel_max * t_b) / bounds.accel_max;
+        time = min(time, rest);
+    }
+    return time;
+}
+
+template <class Objective>
+double search_heuristic(const SearchBounds& bounds, double dH, double dV_ms, const Objective& objective) {
+    double time = search_time_bound(bounds, dH, dV_ms);
+    return objective(time, time * bounds.fuel_flow_min);
+}
+
+// Оценка узла (i, j): наибольшая из общей оценки и строчной - полосы
+// выше строки i и столбцы правее j, из которых r = min(n - i, n - j) пар
+// совмещены разгоном с подъемом. Обе согласованы, их максимум тоже.
+template <class Objective>
+double search_node_heuristic(const SearchBounds& bounds, int i, int j, double dH, double dV_ms, const Objective& objective) {
+    int n = bounds.n;
+    int shortcuts = min(n - i, n - j);
+    double time = max(search_time_bound(bounds, dH, dV_ms),
+        bounds.climb_time[i] + bounds.accel_time[j] - bounds.shortcut_time[n - shortcuts]);
+    double fuel = max(time * bounds.fuel_flow_min,
+        bounds.climb_fuel[i] + bounds.accel_fuel[j] - bounds.shortcut_fuel[n - shortcuts]);
+    return objective(time, fuel);
+}
+
+// Маневр перехода по знакам изменения высоты и скорости
+int move_maneuver(double dH, double dV) {
+    if (dH == 0.0 && dV > 0.0) return RAZGON;
+    if (dH == 0.0 && dV < 0.0) return TORMOZHENIE;
+    if (dV == 0.0 && dH > 0.0) return PODIEM;
+    if (dV == 0.0 && dH < 0.0) return SNIZHENIE;
+    if (dH > 0.0 && dV > 0.0) return RAZGON_PODIEM;
+    return OBMEN_ENERGII;
+}
+
+// Лучший по критерию участок (i1, j1) -> (i2, j2); для переходов на один
+// узел вперед совпадает с best_edge. Точка середины по высоте - индекс i1 + i2.
+template <class Objective>
+SegmentData best_move(const SweepGrid& g, int i1, int j1, int i2, int j2, int maneuver,
+    const PowerSetting& idle, const Objective& objective, int& setting) {
+    const AircraftModel& ac = *g.physics->aircraft;
+    const vector<AltitudePoint>& alt = g.physics->altitude;
+    const vector<double>& V = *g.V_grid_ms;
+
+    setting = 0;
+    if (maneuver == TORMOZHENIE) {
+        return calculate_tormozhenie(ac, alt[2 * i1], V[j1], V[j2], g.mass, idle);
+    }
+    if (maneuver == SNIZHENIE) {
+        return calculate_snizhenie(ac, alt[2 * i1], alt[2 * i2], alt[i1 + i2], V[j1], g.mass, idle);
+    }
+
+    auto kernel = [&](const PowerLanes& lanes, SegmentLanes& out) {
+        if (maneuver == RAZGON) {
+            calculate_razgon_lanes(ac, alt[2 * i1], V[j1], V[j2], g.mass, lanes, out);
+        }
+        else if (maneuver == PODIEM) {
+            calculate_podiem_lanes(ac, alt[2 * i1], alt[2 * i2], alt[i1 + i2], V[j1], g.mass, lanes, g.max_vy_factor, out);
+        }
+        else if (maneuver == RAZGON_PODIEM) {
+            calculate_razgon_podiem_lanes(ac, alt[2 * i1], alt[2 * i2], alt[i1 + i2], V[j1], V[j2], g.mass, lanes,
+                g.max_vy_factor, i2 - i1 > 1 || j2 - j1 > 1, out);
+        }
+        else {
+            calculate_energy_trade_lanes(ac, alt[2 * i1], alt[2 * i2], alt[i1 + i2], V[j1], V[j2], g.mass, lanes,
+                g.max_vy_factor, out);
+        }
+    };
+
+    if (g.physics->continuous) {
+        SegmentLanes out;
+        setting = max(search_power(g.physics->settings, objective, kernel, out), 0);
+        return lane_segment(out, 0);
+    }
+
+    SegmentData best;
+    best.valid = false;
+    best.time = 1e9;
+    best.fuel = 1e9;
+
+    for (size_t block = 0; block < g.physics->lanes.size(); block++) {
+        const PowerLanes& lanes = g.physics->lanes[block];
+        SegmentLanes out;
+        kernel(lanes, out);
+
+        for (int k = 0; k < lanes.count; k++) {
+            SegmentData seg = lane_segment(out, k);
+            if (!seg.valid) continue;
+            if (!best.valid || objective(seg.time, seg.fuel) < objective(best.time, best.fuel)) {
+                best = seg;
+                setting = (int)block * PS_LANES + k;
+            }
+        }
+    }
+    return best;
+}
+
+// Режим двигателей участка пути по номеру setting в physics.settings;
+// торможение и снижение идут на малом газе
+double path_segment_power(const GridPhysics& physics, int maneuver, int setting) {
+    if (maneuver == TORMOZHENIE || maneuver == SNIZHENIE) return IDLE_POWER;
+    return physics.settings[setting].value;
+}
+
+// Шаблон переходов поиска: (di, dj) из [lo..reach]^2 без (0, 0), где lo = -1
+// при обратных переходах и 0 без них. reach = 1 без обратных переходов -
+// те же три маневра, что и в обходе сетки; reach > 1 - длинные участки.
+// Обмен скорости на высоту и переходы назад разрешены только с allow_reverse.
+struct SearchStencil {
+    vector<int> di;
+    vector<int> dj;
+    vector<int> maneuver;
+};
+
+SearchStencil make_search_stencil(int reach, bool allow_reverse, double dH_step, double dV_step) {
+    SearchStencil stencil;
+    int lo = allow_reverse ? -1 : 0;
+    for (int di = lo; di <= reach; di++) {
+        for (int dj = lo; dj <= reach; dj++) {
+            if (di == 0 && dj == 0) continue;
+            int maneuver = move_maneuver(di * dH_step, dj * dV_step);
+            if (!allow_reverse && maneuver != RAZGON && maneuver != PODIEM && maneuver != RAZGON_PODIEM) continue;
+
+            stencil.di.push_back(di);
+            stencil.dj.push_back(dj);
+            stencil.maneuver.push_back(maneuver);
+        }
+    }
+    return stencil;
+}
+
+// Состояние поиска: значения узлов и двоичная куча открытых узлов
+struct HeapEntry {
+    double f;
+    int node;
+};
+
+struct HeapEntryAfter {
+    bool operator()(const HeapEntry& a, const HeapEntry& b) const {
+        return a.f > b.f;
+    }
+};
+
+struct SearchState {
+    int n;
+    vector<double> cost;
+    vector<double> time;
+    vector<double> fuel;
+    vector<int> parent;
+    vector<unsigned char> code;
+    vector<unsigned short> setting;
+    vector<unsigned char> closed;
+    vector<HeapEntry> heap;
+    long long expanded;
+    long long edges;
+
+    void reset(int grid_n) {
+        n = grid_n;
+        size_t cells = ((size_t)n + 1) * ((size_t)n + 1);
+        cost.assign(cells, 1e18);
+        time.assign(cells, 0.0);
+        fuel.assign(cells, 0.0);
+        parent.assign(cells, -1);
+        code.assign(cells, 0);
+        setting.assign(cells, 0);
+        closed.assign(cells, 0);
+        heap.clear();
+        expanded = 0;
+        edges = 0;
+    }
+};
+
+// Объем состояния поиска для сетки n x n, байт
+double search_state_bytes(int n) {
+    double cells = ((double)n + 1.0) * ((double)n + 1.0);
+    return cells * (3.0 * sizeof(double) + sizeof(int) + 2.0 + sizeof(unsigned short));
+}
+
+// informed = false - нулевая оценка (поиск Дейкстры), эталон для проверки A*
+template <class Objective>
+bool search_best_first(SearchState& st, const SweepGrid& g, const vector<double>& H_grid, int n,
+    int reach, bool allow_reverse, bool informed, const Objective& objective) {
+    st.reset(n);
+    const vector<double>& V = *g.V_grid_ms;
+    SearchBounds bounds = make_search_bounds(g, n, reach, allow_reverse);
+    auto heuristic = [&](int i, int j) {
+        return informed ? search_node_heuristic(bounds, i, j, H_grid[n] - H_grid[i], V[n] - V[j], objective) : 0.0;
+    };
+    PowerSetting idle = make_power_setting(IDLE_POWER);
+    const int goal = n * (n + 1) + n;
+
+    // Сетка равномерная, поэтому нижняя оценка стоимости перехода
+    // зависит только от (di, dj) и считается один раз на шаблон
+    double dH_step = (H_grid[n] - H_grid[0]) / n;
+    double dV_step = (V[n] - V[0]) / n;
+    SearchStencil stencil = make_search_stencil(reach, allow_reverse, dH_step, dV_step);
+    const int moves = (int)stencil.di.size();
+    vector<int> offset(moves), candidate(moves);
+    vector<double> move_bound(moves);
+    for (int m = 0; m < moves; m++) {
+        offset[m] = stencil.di[m] * (n + 1) + stencil.dj[m];
+        move_bound[m] = informed ? search_heuristic(bounds, stencil.di[m] * dH_step, stencil.dj[m] * dV_step, objective) : 0.0;
+    }
+
+    st.cost[0] = 0.0;
+    HeapEntry start = { heuristic(0, 0), 0 };
+    st.heap.push_back(start);
+
+    while (!st.heap.empty()) {
+        pop_heap(st.heap.begin(), st.heap.end(), HeapEntryAfter());
+        int node = st.heap.back().node;
+        st.heap.pop_back();
+        if (st.closed[node]) continue;
+        st.closed[node] = 1;
+        st.expanded++;
+        if (node == goal) return true;
+
+        int i = node / (n + 1), j = node % (n + 1);
+        double base = st.cost[node];
+
+        // Отбор переходов без физики, цикл по шаблону без ветвлений:
+        // узел внутри сетки, не закрыт и может быть улучшен хотя бы
+        // на нижнюю оценку перехода
+        int candidates = 0;
+        for (int m = 0; m < moves; m++) {
+            int ni = i + stencil.di[m], nj = j + stencil.dj[m];
+            bool inside = ni >= 0 && ni <= n && nj >= 0 && nj <= n;
+            int next = inside ? node + offset[m] : node;
+            bool open = inside && !st.closed[next] && base + move_bound[m] < st.cost[next];
+            candidate[candidates] = m;
+            candidates += open ? 1 : 0;
+        }
+
+        for (int c = 0; c < candidates; c++) {
+            int m = candidate[c];
+            int ni = i + stencil.di[m], nj = j + stencil.dj[m];
+            int next = node + offset[m];
+
+            int setting;
+            SegmentData seg = best_move(g, i, j, ni, nj, stencil.maneuver[m], idle, objective, setting);
+            st.edges++;
+            if (!seg.valid) continue;
+
+            double next_cost = base + objective(seg.time, seg.fuel);
+            if (next_cost < st.cost[next]) {
+                st.cost[next] = next_cost;
+                st.time[next] = st.time[node] + seg.time;
+                st.fuel[next] = st.fuel[node] + seg.fuel;
+                st.parent[next] = node;
+                st.code[next] = (unsigned char)stencil.maneuver[m];
+                st.setting[next] = (unsigned short)setting;
+
+                HeapEntry entry = { next_cost + heuristic(ni, nj), next };
+                st.heap.push_back(entry);
+                push_heap(st.heap.begin(), st.heap.end(), HeapEntryAfter());
+            }
+        }
+    }
+    return false;
+}
+
+// ДП с учетом массы: масса убывает на сожженное топливо, поэтому
+// к узлу (H, V) добавляется третье измерение - масса. Каждый путь несет
+// метку (стоимость, время, топливо); масса на следующем участке равна
+// начальной минус топливо метки. Сожженное топливо разбито на корзины
+// шириной mass_bucket_kg, в корзине остается одна, самая дешевая метка.
+// Метка отбрасывается, если в узле есть метка не дороже и не тяжелее
+// (сожгла не меньше топлива): более легкий самолет на дальнейших
+// участках не проигрывает.
+struct MassLabel {
+    double cost;
+    double time;
+    double fuel;
+    int prev_label;
+    unsigned char code;
+    unsigned short setting;
+};
+
+const int MAX_MASS_LABELS = 64;
+
+// Метки одного узла лежат подряд, узлы - в порядке антидиагоналей,
+// в котором их заполняет волновой обход
+template <class Label>
+struct LabelStore {
+    int n;
+    vector<Label> labels;
+    vector<size_t> begin;
+    vector<int> count;
+
+    void reset(int grid_n) {
+        n = grid_n;
+        size_t cells = ((size_t)n + 1) * ((size_t)n + 1);
+        labels.clear();
+        begin.assign(cells, 0);
+        count.assign(cells, 0);
+    }
+
+    size_t node(int i, int j) const {
+        return (size_t)i * (n + 1) + j;
+    }
+
+    const Label* at(int i, int j) const {
+        return labels.data() + begin[node(i, j)];
+    }
+};
+
+typedef LabelStore<MassLabel> MassLabelStore;
+
+// Волновой обход для меток: node_labels(i, j, labels) собирает метки узла
+// по уже заполненным диагоналям d-1 и d-2
+template <class Label, class NodeLabels>
+void sweep_labels(LabelStore<Label>& store, int n, const Label& start, ThreadPool* pool, NodeLabels node_labels) {
+    store.reset(n);
+    store.labels.push_back(start);
+    store.count[0] = 1;
+
+    // Метки узлов текущей диагонали; буферы сохраняют емкость между диагоналями
+    vector<vector<Label> > diagonal(n + 1);
+
+    for (int d = 1; d <= 2 * n; d++) {
+        int i_begin = max(0, d - n);
+        int i_end = min(d, n);
+        int nodes = i_end - i_begin + 1;
+
+        function<void(int, int)> body = [&](int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                int i = i_begin + k;
+                diagonal[k].clear();
+                node_labels(i, d - i, diagonal[k]);
+            }
+        };
+
+        if (pool != NULL) pool->parallel_for(nodes, 4, body);
+        else body(0, nodes);
+
+        for (int k = 0; k < nodes; k++) {
+            size_t id = store.node(i_begin + k, d - i_begin - k);
+            store.begin[id] = store.labels.size();
+            store.count[id] = (int)diagonal[k].size();
+            store.labels.insert(store.labels.end(), diagonal[k].begin(), diagonal[k].end());
+        }
+    }
+}
+
+bool heavier_bucket_last(const MassLabel& a, const MassLabel& b, double bucket_kg) {
+    return floor(a.fuel / bucket_kg) > floor(b.fuel / bucket_kg);
+}
+
+// Оставляет по одной метке на корзину и только недоминируемые метки.
+// Результат упорядочен от самой легкой (и самой дорогой) метки к самой тяжелой.
+void prune_mass_labels(vector<MassLabel>& labels, double bucket_kg) {
+    stable_sort(labels.begin(), labels.end(), [bucket_kg](const MassLabel& a, const MassLabel& b) {
+        return heavier_bucket_last(a, b, bucket_kg);
+    });
+
+    size_t kept = 0;
+    double running_min = 1e18;
+    for (size_t k = 0; k < labels.size(); ) {
+        // Лучшая метка корзины; при равной стоимости - первая предложенная
+        size_t best = k;
+        size_t next = k + 1;
+        while (next < labels.size() && !heavier_bucket_last(labels[k], labels[next], bucket_kg)) {
+            if (labels[next].cost < labels[best].cost) best = next;
+            next++;
+        }
+
+        if (labels[best].cost < running_min) {
+            running_min = labels[best].cost;
+            labels[kept++] = labels[best];
+        }
+        k = next;
+    }
+    labels.resize(kept);
+
+    // Сверх лимита отбрасываются самые легкие и дорогие метки
+    if (labels.size() > (size_t)MAX_MASS_LABELS) {
+        labels.erase(labels.begin(), labels.end() - MAX_MASS_LABELS);
+    }
+}
+
+template <class Objective>
+void offer_mass_labels(const MassLabelStore& store, const SweepGrid& g, int i, int j, ManeuverType maneuver,
+    const Objective& objective, vector<MassLabel>& out) {
+    int pi, pj;
+    maneuver_source(maneuver, i, j, pi, pj);
+    const MassLabel* src = store.at(pi, pj);
+    int src_count = store.count[store.node(pi, pj)];
+
+    for (int l = 0; l < src_count; l++) {
+        for (size_t block = 0; block < g.physics->lanes.size(); block++) {
+            SegmentLanes lanes;
+            int first = evaluate_edge_lanes(g, i, j, maneuver, block, g.mass - src[l].fuel, lanes);
+
+            for (int k = 0; k < g.physics->lanes[block].count; k++) {
+                if (!lanes.valid[k]) continue;
+                MassLabel label;
+                label.cost = src[l].cost + objective(lanes.time[k], lanes.fuel[k]);
+                label.time = src[l].time + lanes.time[k];
+                label.fuel = src[l].fuel + lanes.fuel[k];
+                label.prev_label = l;
+                label.code = (unsigned char)maneuver;
+                label.setting = (unsigned short)(first + k);
+                out.push_back(label);
+            }
+        }
+    }
+}
+
+template <class Objective>
+void sweep_mass_aware(MassLabelStore& store, const SweepGrid& g, int n, double bucket_kg, ThreadPool* pool,
+    const Objective& objective) {
+    MassLabel start;
+    start.cost = 0.0;
+    start.time = 0.0;
+    start.fuel = 0.0;
+    start.prev_label = -1;
+    start.code = 0;
+    start.setting = 0;
+
+    sweep_labels(store, n, start, pool, [&](int i, int j, vector<MassLabel>& labels) {
+        if (i > 0 && j > 0) offer_mass_labels(store, g, i, j, RAZGON_PODIEM, objective, labels);
+        if (i > 0) offer_mass_labels(store, g, i, j, PODIEM, objective, labels);
+        if (j > 0) offer_mass_labels(store, g, i, j, RAZGON, objective, labels);
+
+        prune_mass_labels(labels, bucket_kg);
+    });
+}
+
+// Фронт Парето время/топливо. Метка узла - пара (время, топливо) пути из
+// начала; в узле хранятся только недоминируемые метки, упорядоченные по
+// возрастанию времени (топливо при этом строго убывает). Масса постоянна,
+// поэтому участок не зависит от метки: он считается один раз на ребро
+// и режим, а метки источника сдвигаются на его время и топливо, оставаясь
+// упорядоченными. Такие серии сливаются за линейное время.
+struct ParetoLabel {
+    double time;
+    double fuel;
+    int prev_label;
+    unsigned char code;
+    unsigned char setting;
+};
+
+typedef LabelStore<ParetoLabel> ParetoLabelStore;
+
+const int DEFAULT_PARETO_LABELS = 32;
+
+// Группа режимов двигателей со своим ограничением Vy; номера режимов
+// в метках идут подряд по всем группам начиная с first_setting
+struct ParetoRegime {
+    const SweepGrid* grid;
+    int first_setting;
+};
+
+bool pareto_label_less(const ParetoLabel& a, const ParetoLabel& b) {
+    if (a.time != b.time) return a.time < b.time;
+    return a.fuel < b.fuel;
+}
+
+void offer_pareto_labels(const ParetoLabelStore& store, const vector<ParetoRegime>& regimes, int i, int j,
+    ManeuverType maneuver, vector<ParetoLabel>& out) {
+    int pi, pj;
+    maneuver_source(maneuver, i, j, pi, pj);
+    const ParetoLabel* src = store.at(pi, pj);
+    int src_count = store.count[store.node(pi, pj)];
+    if (src_count == 0) return;
+
+    for (size_t r = 0; r < regimes.size(); r++) {
+        const SweepGrid& g = *regimes[r].grid;
+        for (size_t block = 0; block < g.physics->lanes.size(); block++) {
+            SegmentLanes lanes;
+            edge_lanes(g, i, j, maneuver, block, lanes);
+
+            for (int k = 0; k < g.physics->lanes[block].count; k++) {
+                if (!lanes.valid[k]) continue;
+
+                size_t run = out.size();
+                for (int l = 0; l < src_count; l++) {
+                    ParetoLabel label;
+                    label.time = src[l].time + lanes.time[k];
+                    label.fuel = src[l].fuel + lanes.fuel[k];
+                    label.prev_label = l;
+                    label.code = (unsigned char)maneuver;
+                    label.setting = (unsigned char)(regimes[r].first_setting + block * PS_LANES + k);
+                    out.push_back(label);
+                }
+                inplace_merge(out.begin(), out.begin() + run, out.end(), pareto_label_less);
+            }
+        }
+    }
+}
+
+// Оставляет недоминируемые метки. Если их больше max_labels, фронт
+// прореживается: крайние метки сохраняются, промежуточные берутся
+// не чаще чем через равные доли нормированной длины фронта.
+void prune_pareto_labels(vector<ParetoLabel>& labels, int max_labels) {
+    size_t kept = 0;
+    double min_fuel = 1e18;
+    for (size_t k = 0; k < labels.size(); k++) {
+        if (labels[k].fuel < min_fuel) {
+            min_fuel = labels[k].fuel;
+            labels[kept++] = labels[k];
+        }
+    }
+    labels.resize(kept);
+
+    if (labels.size() <= (size_t)max_labels || max_labels < 2) return;
+
+    const ParetoLabel first = labels.front();
+    const ParetoLabel last = labels.back();
+    double time_range = last.time - first.time;
+    double fuel_range = first.fuel - last.fuel;
+    double step = 2.0 / (max_labels - 1);
+
+    kept = 1;
+    for (size_t k = 1; k + 1 < labels.size() && kept + 1 < (size_t)max_labels; k++) {
+        const ParetoLabel& prev = labels[kept - 1];
+        double distance = (labels[k].time - prev.time) / time_range + (prev.fuel - labels[k].fuel) / fuel_range;
+        if (distance >= step) labels[kept++] = labels[k];
+    }
+    labels[kept++] = last;
+    labels.resize(kept);
+}
+
+void sweep_pareto(ParetoLabelStore& store, const vector<ParetoRegime>& regimes, int n, int max_labels,
+    ThreadPool* pool) {
+    ParetoLabel start;
+    start.time = 0.0;
+    start.fuel = 0.0;
+    start.prev_label = -1;
+    start.code = 0;
+    start.setting = 0;
+
+    sweep_labels(store, n, start, pool, [&](int i, int j, vector<ParetoLabel>& labels) {
+        if (i > 0 && j > 0) offer_pareto_labels(store, regimes, i, j, RAZGON_PODIEM, labels);
+        if (i > 0) offer_pareto_labels(store, regimes, i, j, PODIEM, labels);
+        if (j > 0) offer_pareto_labels(store, regimes, i, j, RAZGON, labels);
+
+        prune_pareto_labels(labels, max_labels);
+    });
+}
+
+struct EdgeCache;
+
+// Формат вывода матриц и траекторий (--format)
+enum OutputFormat {
+    OUTPUT_CSV = 1,
+    OUTPUT_BINARY = 2,
+    OUTPUT_BOTH = 3
+};
+
+// Параметры решателя: размер сетки, режим хранения и пул потоков
+struct SolverOptions {
+    int n;
+    bool streaming;
+    bool mass_aware;
+    double mass_bucket_kg;
+    int pareto_labels;
+    ThreadPool* pool;
+    EdgeCache* edge_cache;
+    int coarse_n;
+    int corridor_halfwidth;
+    bool corridor_check;
+    bool search_check;
+    bool best_first;
+    bool allow_reverse;
+    int stencil_reach;
+    bool refine;
+    bool continuous_power;
+    int output;
+    bool quiet;
+};
+
+SolverOptions default_solver_options() {
+    SolverOptions options;
+    options.n = DEFAULT_N;
+    options.streaming = false;
+    options.mass_aware = false;
+    options.mass_bucket_kg = 50.0;
+    options.pareto_labels = DEFAULT_PARETO_LABELS;
+    options.pool = NULL;
+    options.edge_cache = NULL;
+    options.coarse_n = 0;
+    options.corridor_halfwidth = 4;
+    options.corridor_check = false;
+    options.search_check = false;
+    options.best_first = false;
+    options.allow_reverse = false;
+    options.stencil_reach = 1;
+    options.refine = false;
+    options.continuous_power = false;
+    options.output = OUTPUT_CSV;
+    options.quiet = false;
+    return options;
+}
+
+// Таблица ребер для серии CI строится только до этого объема, байт
+const double EDGE_TABLE_LIMIT = 1024.0 * 1024.0 * 1024.0;
+
+// Объем полных таблиц ДП для сетки n x n, байт
+double full_store_bytes(int n) {
+    double cells = ((double)n + 1.0) * ((double)n + 1.0);
+    return cells * (3.0 * sizeof(double) + 1.0 + sizeof(unsigned short));
+}
+
+// Больше этого объема полные таблицы не строятся (потоковый режим), байт
+const double FULL_STORE_LIMIT = 2.0 * 1024.0 * 1024.0 * 1024.0;
+
+// Постановка задачи: самолет, атмосфера, масса, граничные условия по высоте
+// и скорости и критерий
+struct Scenario {
+    string name;
+    const AircraftModel* aircraft;
+    const UniformAtmosphere* atmosphere;
+    double mass;
+    double H_start;
+    double H_finish;
+    double V_start_kmh;
+    double V_finish_kmh;
+    OptimizationCriterion criterion;
+    double cost_index;
+};
+
+Scenario default_scenario(OptimizationCriterion criterion, string name, const AircraftModel& aircraft,
+    const UniformAtmosphere& atmosphere) {
+    Scenario sc;
+    sc.name = name;
+    sc.aircraft = &aircraft;
+    sc.atmosphere = &atmosphere;
+    sc.mass = aircraft.mass;
+    sc.H_start = H_START;
+    sc.H_finish = H_FINISH;
+    sc.V_start_kmh = V_START_KMH;
+    sc.V_finish_kmh = V_FINISH_KMH;
+    sc.criterion = criterion;
+    sc.cost_index = 0.0;
+    return sc;
+}
+
+// Итоги решения "от грубой сетки к точной"
+struct CorridorReport {
+    vector<int> level_n;
+    vector<double> level_cost;
+    double cells;
+    int halfwidth;
+    bool touches_boundary;
+};
+
+// Точки шагов интегратора при пересчете пути, по столбцу на величину.
+// Память выделяется до интегрирования (не больше REFINE_MAX_STEPS + 1
+// точек на участок), сам цикл интегрирования ничего не выделяет.
+struct RefineTrace {
+    vector<double> time;
+    vector<double> H;
+    vector<double> V_kmh;
+    vector<double> mass;
+    vector<double> fuel;
+    vector<int> segment;
+    size_t count;
+};
+
+// Сетка, физика и таблицы ДП одного решения.
+// Один экземпляр можно использовать для последовательных решений.
+struct SolveWorkspace {
+    vector<double> H_grid;
+    vector<double> V_grid_kmh;
+    vector<double> V_grid_ms;
+    vector<double> power_settings;
+    GridPhysics physics;
+    SweepGrid grid;
+    DPStore store;
+    StreamingRazgon razgon;
+    MassLabelStore labels;
+    EdgeCostTable edges;
+    Corridor corridor;
+    CorridorReport c2f;
+    SearchState search;
+    bool searched;
+    RefineTrace refine;
+};
+
+// Наибольшее число режимов двигателей в наборе (MIN_COST)
+const int MAX_POWER_SETTINGS = 6;
+
+// Шагов решетки непрерывного режима двигателей на отрезке набора
+const int POWER_LATTICE_STEPS = 256;
+
+// Решетка непрерывного режима: отрезок от наименьшего до наибольшего
+// режима набора делится примерно на POWER_LATTICE_STEPS равных шагов,
+// режимы набора остаются узлами решетки. Набор задан по убыванию,
+// решетка - по возрастанию.
+void expand_power_lattice(vector<double>& power_settings) {
+    int count = (int)power_settings.size();
+    double range = power_settings[0] - power_settings[count - 1];
+
+    // Решетка дописывается за набором, затем набор удаляется
+    power_settings.push_back(power_settings[count - 1]);
+    for (int k = count - 1; k > 0; k--) {
+        double from = power_settings[k];
+        double gap = power_settings[k - 1] - from;
+        int steps = max(1, (int)floor(POWER_LATTICE_STEPS * gap / range + 0.5));
+        for (int s = 1; s < steps; s++) {
+            power_settings.push_back(from + gap * s / steps);
+        }
+        power_settings.push_back(power_settings[k - 1]);
+    }
+    power_settings.erase(power_settings.begin(), power_settings.begin() + count);
+}
+
+void setup_grid(const Scenario& sc, int n, SolveWorkspace& ws, bool continuous_power) {
+    double dH = (sc.H_finish - sc.H_start) / n;
+    double dV_kmh = (sc.V_finish_kmh - sc.V_start_kmh) / n;
+
+    ws.H_grid.resize(n + 1);
+    ws.V_grid_kmh.resize(n + 1);
+    ws.V_grid_ms.resize(n + 1);
+
+    for (int i = 0; i <= n; i++) {
+        ws.H_grid[i] = sc.H_start + i * dH;
+        ws.V_grid_kmh[i] = sc.V_start_kmh + i * dV_kmh;
+        ws.V_grid_ms[i] = ws.V_grid_kmh[i] / 3.6;
+    }
+
+    double max_vy_factor;
+    ws.power_settings.clear();
+
+    if (sc.criterion == MIN_TIME) {
+        ws.power_settings.push_back(1.08);
+        ws.power_settings.push_back(1.05);
+        ws.power_settings.push_back(1.00);
+        max_vy_factor = 1.0;
+    }
+    else if (sc.criterion == MIN_COST) {
+        // Индекс стоимости выбирает между обоими наборами режимов сам
+        ws.power_settings.push_back(1.08);
+        ws.power_settings.push_back(1.05);
+        ws.power_settings.push_back(1.00);
+        ws.power_settings.push_back(0.88);
+        ws.power_settings.push_back(0.82);
+        ws.power_settings.push_back(0.75);
+        max_vy_factor = 1.0;
+    }
+    else {
+        ws.power_settings.push_back(0.88);
+        ws.power_settings.push_back(0.82);
+        ws.power_settings.push_back(0.75);
+        max_vy_factor = 0.65;
+    }
+
+    if (continuous_power) expand_power_lattice(ws.power_settings);
+
+    build_grid_physics(ws.physics, *sc.aircraft, *sc.atmosphere, ws.H_grid, ws.power_settings, continuous_power);
+
+    ws.grid.physics = &ws.physics;
+    ws.grid.V_grid_ms = &ws.V_grid_ms;
+    ws.grid.mass = sc.mass;
+    ws.grid.max_vy_factor = max_vy_factor;
+    ws.grid.criterion = sc.criterion;
+    ws.grid.cost_index = sc.cost_index;
+    ws.grid.edges = NULL;
+}
+
+// Кэш участков ребер одной сетки: столбцы времени и топлива для каждой
+// пары (режим двигателей, множитель Vy). Режим участвует в решениях
+// разных критериев с одним и тем же столбцом (например, MIN_TIME и серия
+// CI), а файл кэша позволяет повторным запускам на той же сетке
+// не считать физику заново. Решения, использующие кэш, идут по очереди.
+struct EdgeColumn {
+    double power;
+    double vy_factor;
+    vector<double> time;
+    vector<double> fuel;
+};
+
+// Сетка, для которой посчитаны столбцы
+struct EdgeCacheKey {
+    int n;
+    double mass;
+    double H_start;
+    double H_finish;
+    double V_start_kmh;
+    double V_finish_kmh;
+    unsigned long long atmosphere;  // UniformAtmosphere::signature
+};
+
+struct EdgeCache {
+    EdgeCacheKey key;
+    bool dirty;
+    deque<EdgeColumn> columns;
+
+    EdgeCache() : dirty(false) {
+        key.n = 0;
+    }
+};
+
+EdgeCacheKey edge_cache_key(const Scenario& sc, int n) {
+    EdgeCacheKey key;
+    key.n = n;
+    key.mass = sc.mass;
+    key.H_start = sc.H_start;
+    key.H_finish = sc.H_finish;
+    key.V_start_kmh = sc.V_start_kmh;
+    key.V_finish_kmh = sc.V_finish_kmh;
+    key.atmosphere = sc.atmosphere->signature;
+    return key;
+}
+
+bool same_edge_cache_key(const EdgeCacheKey& a, const EdgeCacheKey& b) {
+    return a.n == b.n && a.mass == b.mass && a.H_start == b.H_start && a.H_finish == b.H_finish &&
+        a.V_start_kmh == b.V_start_kmh && a.V_finish_kmh == b.V_finish_kmh && a.atmosphere == b.atmosphere;
+}
+
+EdgeColumn* find_edge_column(EdgeCache& cache, double power, double vy_factor) {
+    for (size_t c = 0; c < cache.columns.size(); c++) {
+        if (cache.columns[c].power == power && cache.columns[c].vy_factor == vy_factor) return &cache.columns[c];
+    }
+    return NULL;
+}
+
+// Подключает к ws.grid таблицу ребер из кэша, досчитывая недостающие
+// режимы. Если кэш построен для другой сетки, он очищается.
+// Возвращает false, если столбцы не помещаются в EDGE_TABLE_LIMIT.
+bool attach_edge_cache(EdgeCache& cache, const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws) {
+    // Режим участка в непрерывном режиме зависит от критерия - столбцов нет
+    if (ws.physics.continuous) return false;
+
+    const int N = options.n;
+    EdgeCacheKey key = edge_cache_key(sc, N);
+    if (!same_edge_cache_key(cache.key, key)) {
+        cache.columns.clear();
+        cache.key = key;
+    }
+
+    size_t settings = ws.power_settings.size();
+    vector<double*> time_cols(settings, NULL), fuel_cols(settings, NULL);
+    size_t missing = 0;
+    for (size_t s = 0; s < settings; s++) {
+        if (find_edge_column(cache, ws.power_settings[s], ws.grid.max_vy_factor) == NULL) missing++;
+    }
+    if ((cache.columns.size() + missing) * edge_column_bytes(N) > EDGE_TABLE_LIMIT) {
+        return false;
+    }
+
+    for (size_t s = 0; s < settings; s++) {
+        if (find_edge_column(cache, ws.power_settings[s], ws.grid.max_vy_factor) != NULL) continue;
+        cache.columns.push_back(EdgeColumn());
+        EdgeColumn& column = cache.columns.back();
+        column.power = ws.power_settings[s];
+        column.vy_factor = ws.grid.max_vy_factor;
+        column.time.resize(edge_column_size(N));
+        column.fuel.resize(edge_column_size(N));
+        time_cols[s] = column.time.data();
+        fuel_cols[s] = column.fuel.data();
+    }
+
+    if (missing > 0) {
+        build_edge_columns(ws.grid, N, time_cols, fuel_cols,
+            (options.pool != NULL && options.pool->size() > 1) ? options.pool : NULL);
+        cache.dirty = true;
+    }
+
+    ws.edges.n = N;
+    ws.edges.time.resize(settings);
+    ws.edges.fuel.resize(settings);
+    for (size_t s = 0; s < settings; s++) {
+        const EdgeColumn* column = find_edge_column(cache, ws.power_settings[s], ws.grid.max_vy_factor);
+        ws.edges.time[s] = column->time.data();
+        ws.edges.fuel[s] = column->fuel.data();
+    }
+    ws.grid.edges = &ws.edges;
+    return true;
+}
+
+// Файл кэша: сигнатура формата и модели самолета, ключ сетки, затем
+// столбцы (режим, множитель Vy, время и топливо всех ребер)
+const char EDGE_CACHE_MAGIC[8] = { 'D', 'Z', 'E', 'D', 'G', 'E', '0', '4' };
+const int EDGE_CACHE_MODEL_SIZE = 25;
+
+void edge_cache_model(const AircraftModel& ac, double* model) {
+    const double values[EDGE_CACHE_MODEL_SIZE] = {
+        ac.wing_area, (double)ac.engine_count, ac.thrust_percent,
+        ac.thrust_sea, ac.thrust_lapse, ac.thrust_lapse_power, ac.thrust_mach0, ac.thrust_mach_slope, ac.thrust_mach_max,
+        ac.cy0, ac.cy1, ac.cx0, ac.k_induced, ac.cx_min, ac.alpha_max,
+        ac.cp_base, ac.sfc_altitude, ac.sfc_mach,
+        ac.V_min_kmh, ac.V_max_kmh, ac.H_max, ac.M_max,
+        MAX_VERTICAL_SPEED, MAX_CLIMB_ANGLE, MIN_CLIMB_SPEED_KMH
+    };
+    copy(values, values + EDGE_CACHE_MODEL_SIZE, model);
+}
+
+// Ключ пишется по полям: байты выравнивания структуры не попадают в файл,
+// и файл однозначно определяется содержимым кэша
+void write_edge_cache_key(ofstream& out, const EdgeCacheKey& key) {
+    const double values[5] = { key.mass, key.H_start, key.H_finish, key.V_start_kmh, key.V_finish_kmh };
+    out.write((const char*)&key.n, sizeof(key.n));
+    out.write((const char*)values, sizeof(values));
+    out.write((const char*)&key.atmosphere, sizeof(key.atmosphere));
+}
+
+void read_edge_cache_key(ifstream& in, EdgeCacheKey& key) {
+    double values[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    key.n = 0;
+    key.atmosphere = 0;
+    in.read((char*)&key.n, sizeof(key.n));
+    in.read((char*)values, sizeof(values));
+    in.read((char*)&key.atmosphere, sizeof(key.atmosphere));
+    key.mass = values[0];
+    key.H_start = values[1];
+    key.H_finish = values[2];
+    key.V_start_kmh = values[3];
+    key.V_finish_kmh = values[4];
+}
+
+bool save_edge_cache(const EdgeCache& cache, const string& path, const AircraftModel& aircraft) {
+    ofstream out(path.c_str(), ios::binary);
+    if (!out) return false;
+
+    double model[EDGE_CACHE_MODEL_SIZE];
+    edge_cache_model(aircraft, model);
+    unsigned int count = (unsigned int)cache.columns.size();
+    out.write(EDGE_CACHE_MAGIC, sizeof(EDGE_CACHE_MAGIC));
+    out.write((const char*)model, sizeof(model));
+    write_edge_cache_key(out, cache.key);
+    out.write((const char*)&count, sizeof(count));
+
+    size_t column_size = edge_column_size(cache.key.n);
+    for (size_t c = 0; c < cache.columns.size(); c++) {
+        const EdgeColumn& column = cache.columns[c];
+        out.write((const char*)&column.power, sizeof(double));
+        out.write((const char*)&column.vy_factor, sizeof(double));
+        out.write((const char*)column.time.data(), column_size * sizeof(double));
+        out.write((const char*)column.fuel.data(), column_size * sizeof(double));
+    }
+    return (bool)out;
+}
+
+// Файл другой модели или поврежденный файл не загружается
+bool load_edge_cache(EdgeCache& cache, const string& path, const AircraftModel& aircraft) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(EDGE_CACHE_MAGIC)];
+    double model[EDGE_CACHE_MODEL_SIZE], expected[EDGE_CACHE_MODEL_SIZE];
+    EdgeCacheKey key;
+    unsigned int count = 0;
+    edge_cache_model(aircraft, expected);
+    in.read(magic, sizeof(magic));
+    in.read((char*)model, sizeof(model));
+    read_edge_cache_key(in, key);
+    in.read((char*)&count, sizeof(count));
+    if (!in || !equal(magic, magic + sizeof(magic), EDGE_CACHE_MAGIC) ||
+        !equal(model, model + EDGE_CACHE_MODEL_SIZE, expected) || key.n < 1 || key.n > MAX_N) {
+        return false;
+    }
+
+    size_t column_size = edge_column_size(key.n);
+    deque<EdgeColumn> columns(count);
+    for (unsigned int c = 0; c < count; c++) {
+        EdgeColumn& column = columns[c];
+        column.time.resize(column_size);
+        column.fuel.resize(column_size);
+        in.read((char*)&column.power, sizeof(double));
+        in.read((char*)&column.vy_factor, sizeof(double));
+        in.read((char*)column.time.data(), column_size * sizeof(double));
+        in.read((char*)column.fuel.data(), column_size * sizeof(double));
+        if (!in) return false;
+    }
+
+    cache.key = key;
+    cache.columns.swap(columns);
+    cache.dirty = false;
+    return true;
+}
+
+// Восстановление пути по кодам маневров от узла (ti, tj) к началу (в обратном
+// порядке). В потоковом режиме значения есть только у последней строки: ti = N.
+template <class Objective>
+bool trace_store(SolveWorkspace& ws, int ti, int tj, TrajectoryResult& trajectory, const Objective& objective) {
+    DPStore& store = ws.store;
+    DPRow last_row = store.row(ti);
+    if (last_row.cost[tj] >= 1e9) return false;
+
+    int ci = ti, cj = tj;
+    while (true) {
+        int code = store.code_at(ci, cj);
+        trajectory.path.push_back(make_pair(ws.H_grid[ci], ws.V_grid_kmh[cj]));
+        trajectory.maneuvers.push_back(code == 0 ? RAZGON : (ManeuverType)code);
+        if (code == 0) break;
+
+        int pi, pj;
+        maneuver_source(code, ci, cj, pi, pj);
+
+        // Без полных таблиц участок и его режим пересчитываются по физической модели
+        int setting;
+        if (!store.streaming()) {
+            trajectory.segment_times.push_back(store.time_at(ci, cj) - store.time_at(pi, pj));
+            trajectory.segment_fuels.push_back(store.fuel_at(ci, cj) - store.fuel_at(pi, pj));
+            setting = store.setting_at(ci, cj);
+        }
+        else {
+            SegmentData seg = best_edge(ws.grid, ci, cj, code, objective, setting);
+            trajectory.segment_times.push_back(seg.time);
+            trajectory.segment_fuels.push_back(seg.fuel);
+        }
+        trajectory.segment_powers.push_back(path_segment_power(ws.physics, code, setting));
+
+        ci = pi;
+        cj = pj;
+    }
+
+    trajectory.total_time = last_row.time[tj];
+    trajectory.total_fuel = last_row.fuel[tj];
+    return true;
+}
+
+// Лучшие по критерию метки массы каждого узла - в ws.store (для вывода матриц)
+void store_mass_labels(SolveWorkspace& ws, int N) {
+    const MassLabelStore& labels = ws.labels;
+    DPStore& store = ws.store;
+    store.reset(N, false);
+
+    for (int i = 0; i <= N; i++) {
+        DPRow row = store.row(i);
+        for (int j = 0; j <= N; j++) {
+            const MassLabel* node = labels.at(i, j);
+            for (int l = 0; l < labels.count[labels.node(i, j)]; l++) {
+                if (node[l].cost < row.cost[j]) {
+                    row.cost[j] = node[l].cost;
+                    row.time[j] = node[l].time;
+                    row.fuel[j] = node[l].fuel;
+                    row.code[j] = node[l].code;
+                }
+            }
+        }
+    }
+}
+
+// Восстановление пути по меткам массы от лучшей метки узла (ti, tj)
+bool trace_mass_labels(const SolveWorkspace& ws, int ti, int tj, TrajectoryResult& trajectory) {
+    const MassLabelStore& labels = ws.labels;
+    int final_count = labels.count[labels.node(ti, tj)];
+    if (final_count == 0) return false;
+
+    const MassLabel* final_labels = labels.at(ti, tj);
+    int best = 0;
+    for (int l = 1; l < final_count; l++) {
+        if (final_labels[l].cost < final_labels[best].cost) best = l;
+    }
+
+    int ci = ti, cj = tj, cl = best;
+    while (true) {
+        const MassLabel& label = labels.at(ci, cj)[cl];
+        trajectory.path.push_back(make_pair(ws.H_grid[ci], ws.V_grid_kmh[cj]));
+        trajectory.maneuvers.push_back(label.code == 0 ? RAZGON : (ManeuverType)label.code);
+        trajectory.point_masses.push_back(ws.grid.mass - label.fuel);
+        if (label.code == 0) break;
+
+        int pi, pj;
+        maneuver_source(label.code, ci, cj, pi, pj);
+        const MassLabel& prev = labels.at(pi, pj)[label.prev_label];
+        trajectory.segment_times.push_back(label.time - prev.time);
+        trajectory.segment_fuels.push_back(label.fuel - prev.fuel);
+        trajectory.segment_powers.push_back(path_segment_power(ws.physics, label.code, label.setting));
+
+        ci = pi;
+        cj = pj;
+        cl = label.prev_label;
+    }
+
+    trajectory.total_time = final_labels[best].time;
+    trajectory.total_fuel = final_labels[best].fuel;
+    return true;
+}
+
+// Очистка результата для нового решения; векторы сохраняют емкость
+void reset_trajectory(TrajectoryResult& trajectory, const string& name) {
+    trajectory.path.clear();
+    trajectory.maneuvers.clear();
+    trajectory.segment_times.clear();
+    trajectory.segment_fuels.clear();
+    trajectory.point_masses.clear();
+    trajectory.segment_powers.clear();
+    trajectory.name = name;
+    trajectory.found = false;
+    trajectory.total_time = 0.0;
+    trajectory.total_fuel = 0.0;
+    trajectory.avg_vy = 0.0;
+    trajectory.used_razgon = 0;
+    trajectory.used_podiem = 0;
+    trajectory.used_combined = 0;
+    trajectory.used_reverse = 0;
+    trajectory.refine.done = false;
+}
+
+TrajectoryResult empty_trajectory(const string& name) {
+    TrajectoryResult trajectory;
+    reset_trajectory(trajectory, name);
+    return trajectory;
+}
+
+// Путь восстановлен от конца к началу: разворот и подсчет маневров
+void finish_trajectory(const Scenario& sc, TrajectoryResult& trajectory) {
+    vector<pair<double, double> >& path = trajectory.path;
+    vector<ManeuverType>& path_maneuvers = trajectory.maneuvers;
+    vector<double>& seg_times = trajectory.segment_times;
+    vector<double>& seg_fuels = trajectory.segment_fuels;
+
+    reverse(path.begin(), path.end());
+    reverse(path_maneuvers.begin(), path_maneuvers.end());
+    reverse(seg_times.begin(), seg_times.end());
+    reverse(seg_fuels.begin(), seg_fuels.end());
+    reverse(trajectory.point_masses.begin(), trajectory.point_masses.end());
+    reverse(trajectory.segment_powers.begin(), trajectory.segment_powers.end());
+
+    for (size_t k = 1; k < path_maneuvers.size(); k++) {
+        if (path_maneuvers[k] == RAZGON) trajectory.used_razgon++;
+        else if (path_maneuvers[k] == PODIEM) trajectory.used_podiem++;
+        else if (path_maneuvers[k] == RAZGON_PODIEM) trajectory.used_combined++;
+        else trajectory.used_reverse++;
+    }
+
+    trajectory.found = true;
+    trajectory.avg_vy = trajectory.total_time > 0 ? (sc.H_finish - sc.H_start) / trajectory.total_time : 0.0;
+}
+
+// Обход сетки ws.grid в ws.store способом, заданным options (без восстановления пути)
+template <class Objective>
+void sweep_store(const SolverOptions& options, SolveWorkspace& ws, const Corridor* corridor,
+    const Objective& objective) {
+    const int N = options.n;
+    bool parallel = options.pool != NULL && options.pool->size() > 1;
+    DPStore& store = ws.store;
+    store.reset(N, options.streaming);
+
+    if (corridor != NULL) {
+        sweep_corridor(store, ws.grid, N, *corridor, objective);
+    }
+    else if (store.streaming() && parallel) {
+        sweep_streaming(store, ws.grid, N, *options.pool, ws.razgon, objective);
+    }
+    else if (parallel) {
+        sweep_wavefront(store, ws.grid, N, *options.pool, objective);
+    }
+    else {
+        sweep_serial(store, ws.grid, N, objective);
+    }
+}
+
+// ДП на уже построенной сетке ws.grid; критерий выбирается один раз,
+// обход компилируется отдельно для каждой политики стоимости
+// corridor != NULL - считаются только узлы коридора (последовательно)
+bool solve_grid(const SolverOptions& options, SolveWorkspace& ws, TrajectoryResult& trajectory,
+    const Corridor* corridor) {
+    const int N = options.n;
+    bool parallel = options.pool != NULL && options.pool->size() > 1;
+    bool found = false;
+
+    with_objective(ws.grid, [&](const auto& objective) {
+        if (options.mass_aware) {
+            sweep_mass_aware(ws.labels, ws.grid, N, options.mass_bucket_kg, parallel ? options.pool : NULL,
+                objective);
+            store_mass_labels(ws, N);
+            found = trace_mass_labels(ws, N, N, trajectory);
+            return;
+        }
+
+        sweep_store(options, ws, corridor, objective);
+        found = trace_store(ws, N, N, trajectory, objective);
+    });
+    return found;
+}
+
+// Поиск A* на сетке ws.grid и восстановление пути. В полном режиме
+// в ws.store записываются значения закрытых узлов (остальные - "---").
+bool solve_best_first(const SolverOptions& options, SolveWorkspace& ws, TrajectoryResult& trajectory) {
+    const int N = options.n;
+    SearchState& st = ws.search;
+    bool found = false;
+    with_objective(ws.grid, [&](const auto& objective) {
+        found = search_best_first(st, ws.grid, ws.H_grid, N, options.stencil_reach, options.allow_reverse, true,
+            objective);
+    });
+
+    DPStore& store = ws.store;
+    store.reset(N, options.streaming);
+    if (!store.streaming()) {
+        for (int i = 0; i <= N; i++) {
+            DPRow row = store.row(i);
+            for (int j = 0; j <= N; j++) {
+                size_t node = (size_t)i * (N + 1) + j;
+                if (!st.closed[node]) continue;
+                row.cost[j] = st.cost[node];
+                row.time[j] = st.time[node];
+                row.fuel[j] = st.fuel[node];
+                row.code[j] = st.code[node] <= RAZGON_PODIEM ? st.code[node] : 0;
+            }
+        }
+    }
+    if (!found) return false;
+
+    int node = N * (N + 1) + N;
+    while (true) {
+        int i = node / (N + 1), j = node % (N + 1);
+        int prev = st.parent[node];
+        trajectory.path.push_back(make_pair(ws.H_grid[i], ws.V_grid_kmh[j]));
+        trajectory.maneuvers.push_back(prev < 0 ? RAZGON : (ManeuverType)st.code[node]);
+        if (prev < 0) break;
+
+        trajectory.segment_times.push_back(st.time[node] - st.time[prev]);
+        trajectory.segment_fuels.push_back(st.fuel[node] - st.fuel[prev]);
+        trajectory.segment_powers.push_back(path_segment_power(ws.physics, st.code[node], st.setting[node]));
+        node = prev;
+    }
+
+    trajectory.total_time = st.time[N * (N + 1) + N];
+    trajectory.total_fuel = st.fuel[N * (N + 1) + N];
+    return true;
+}
+
+// Метка критерия для отчетов: time, fuel или ci<значение CI>
+string criterion_label(const Scenario& sc) {
+    if (sc.criterion == MIN_TIME) return "time";
+    if (sc.criterion == MIN_FUEL) return "fuel";
+    ostringstream label;
+    label << "ci" << sc.cost_index;
+    return label.str();
+}
+
+// Узлы найденного пути от (0, 0) до (N, N) по кодам маневров
+void trace_nodes(const DPStore& store, int N, vector<pair<int, int> >& nodes) {
+    nodes.clear();
+    int ci = N, cj = N;
+    while (true) {
+        nodes.push_back(make_pair(ci, cj));
+        int code = store.code_at(ci, cj);
+        if (code == 0) break;
+
+        int pi, pj;
+        maneuver_source(code, ci, cj, pi, pj);
+        ci = pi;
+        cj = pj;
+    }
+    reverse(nodes.begin(), nodes.end());
+}
+
+// Решение "от грубой сетки к точной": сначала полная сетка coarse_n, затем
+// сетка удваивается до options.n и на каждом уровне считается только
+// коридор +-corridor_halfwidth узлов вокруг пути предыдущего уровня.
+// Если в коридоре пути нет, коридор расширяется вдвое.
+bool solve_coarse_to_fine(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws,
+    TrajectoryResult& trajectory) {
+    CorridorReport& report = ws.c2f;
+    report.halfwidth = options.corridor_halfwidth;
+    report.touches_boundary = false;
+
+    SolverOptions level = options;
+    level.n = options.coarse_n;
+    setup_grid(sc, level.n, ws, options.continuous_power);
+    if (!solve_grid(level, ws, trajectory, NULL)) return false;
+
+    vector<pair<int, int> > nodes;
+    trace_nodes(ws.store, level.n, nodes);
+    report.level_n.push_back(level.n);
+    report.level_cost.push_back(ws.store.row(level.n).cost[level.n]);
+    report.cells = ((double)level.n + 1.0) * ((double)level.n + 1.0);
+
+    while (level.n < options.n) {
+        SolverOptions fine = level;
+        fine.n = min(options.n, 2 * level.n);
+        setup_grid(sc, fine.n, ws, options.continuous_power);
+
+        bool found;
+        while (true) {
+            build_corridor(nodes, level.n, fine.n, report.halfwidth, ws.corridor);
+            trajectory = empty_trajectory(sc.name);
+            found = solve_grid(fine, ws, trajectory, &ws.corridor);
+            report.cells += corridor_cells(ws.corridor);
+            if (found || corridor_is_full(ws.corridor)) break;
+            report.halfwidth *= 2;
+        }
+        if (!found) return false;
+
+        level = fine;
+        trace_nodes(ws.store, level.n, nodes);
+        report.level_n.push_back(level.n);
+        report.level_cost.push_back(ws.store.row(level.n).cost[level.n]);
+    }
+
+    // Путь, прижатый к краю коридора, мог бы улучшиться за его пределами
+    for (size_t k = 0; k < nodes.size(); k++) {
+        int i = nodes[k].first, j = nodes[k].second;
+        if ((j == ws.corridor.lo[i] && j > 0) || (j == ws.corridor.hi[i] && j < level.n)) {
+            report.touches_boundary = true;
+        }
+    }
+    return true;
+}
+
+// Стоимость траектории по критерию сценария
+double trajectory_cost(const Scenario& sc, const TrajectoryResult& trajectory) {
+    if (sc.criterion == MIN_TIME) return trajectory.total_time;
+    if (sc.criterion == MIN_FUEL) return trajectory.total_fuel;
+    return trajectory.total_time * sc.cost_index / 60.0 + trajectory.total_fuel;
+}
+
+// Пересчет найденного пути интегрированием по времени. В ДП участок
+// считается один раз по средним значениям (V_avg, h_avg, масса в начале
+// участка); здесь те же уравнения движения интегрируются вдоль участка
+// методом Дормана - Принса 5(4) с автоматическим шагом, масса убывает
+// непрерывно. Режим двигателей участка берется тот, который выбрало ДП.
+const int REFINE_MAX_STEPS = 64;
+const double REFINE_RTOL = 1e-8;
+const double REFINE_ATOL = 1e-6;
+
+// Участок пути: H и V меняются линейно по параметру s = 0..1
+struct RefineSegment {
+    int maneuver;
+    double H1;
+    double dH;
+    double V1;
+    double dV;
+    PowerSetting ps;
+    double max_vy_factor;
+    double dt_kinematic;
+    double dHe;
+    bool lane_rates;  // разгон с подъемом на несколько ячеек сетки
+};
+
+// Производные времени и израсходованного топлива по s в точке участка.
+// false - в этой точке маневр невозможен (та же отбраковка, что в ядрах ДП).
+bool refine_rates(const AircraftModel& ac, const UniformAtmosphere& atm, const RefineSegment& seg, double s,
+    double mass, double* rate) {
+    double H = seg.H1 + s * seg.dH;
+    double V = seg.V1 + s * seg.dV;
+    AltitudePoint h = make_altitude_point(ac, atm, H);
+
+    double P_max = total_thrust(ac, h, V);
+    double P_used = P_max * seg.ps.value;
+    bool idle = seg.maneuver == TORMOZHENIE || seg.maneuver == SNIZHENIE;
+    double alpha_deg = calculate_alpha(ac, h, V, mass, idle ? P_used : P_max);
+    double q = 0.5 * h.rho * V * V;
+    double X = Cx_alpha(ac, alpha_deg) * q * ac.wing_area;
+
+    double dt_ds;
+    if (seg.maneuver == RAZGON || seg.maneuver == TORMOZHENIE) {
+        double dV_dt = (P_used * cos(alpha_deg / DEG_TO_RAD) - X) / mass;
+        if (dV_dt * seg.dV <= 0.0 || fabs(dV_dt) <= 0.01) return false;
+        dt_ds = seg.dV / dV_dt;
+    }
+    else if (seg.maneuver == PODIEM || seg.maneuver == SNIZHENIE) {
+        double g_climb = G - V * atmosphere_wind_shear(atm, H);
+        double sin_theta = min(fabs(P_used - X) / (mass * g_climb), sin(MAX_CLIMB_ANGLE / DEG_TO_RAD));
+        if ((P_used - X) * seg.dH <= 0.0 || sin_theta <= 0.005) return false;
+        dt_ds = fabs(seg.dH) / min(V * sin_theta, MAX_VERTICAL_SPEED * seg.max_vy_factor);
+    }
+    else if (seg.maneuver == RAZGON_PODIEM) {
+        dt_ds = seg.dt_kinematic;
+        if (seg.lane_rates) {
+            // Не быстрее разгона и подъема на этом режиме подряд
+            double dV_dt = (P_used * cos(alpha_deg / DEG_TO_RAD) - X) / mass;
+            double g_climb = G - V * atmosphere_wind_shear(atm, H);
+            double sin_theta = min((P_used - X) / (mass * g_climb), sin(MAX_CLIMB_ANGLE / DEG_TO_RAD));
+            if (dV_dt <= 0.01 || sin_theta <= 0.005) return false;
+            double Vy = min(V * sin_theta, MAX_VERTICAL_SPEED * seg.max_vy_factor);
+            dt_ds = max(dt_ds, seg.dV / dV_dt + seg.dH / Vy);
+        }
+    }
+    else {
+        double Ps = (P_used - X) * V / (mass * G);
+        if (fabs(Ps) <= 0.01 || seg.dHe / Ps < 0.0) return false;
+        dt_ds = max(seg.dt_kinematic, seg.dHe / Ps);
+    }
+
+    rate[0] = dt_ds;
+    rate[1] = specific_fuel_consumption(ac, h, V, seg.ps) * P_used * dt_ds / 3600.0;
+    return true;
+}
+
+void push_refine_point(RefineTrace& trace, const RefineSegment& seg, double s, int segment,
+    double mass0, const double* y) {
+    size_t p = trace.count++;
+    trace.time[p] = y[0];
+    trace.H[p] = seg.H1 + s * seg.dH;
+    trace.V_kmh[p] = (seg.V1 + s * seg.dV) * 3.6;
+    trace.mass[p] = mass0 - y[1];
+    trace.fuel[p] = y[1];
+    trace.segment[p] = segment;
+}
+
+// Один участок; y = {время, топливо} от начала пути, mass0 - стартовая масса.
+// Шаг не меньше 1 / REFINE_MAX_STEPS: на таком шаге ошибка уже не проверяется.
+bool integrate_segment(const AircraftModel& ac, const UniformAtmosphere& atm, const RefineSegment& seg, int segment,
+    double mass0, double* y, RefineTrace& trace, int& rejected) {
+    static const double A[6][6] = {
+        { 1.0 / 5.0 },
+        { 3.0 / 40.0, 9.0 / 40.0 },
+        { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0 },
+        { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0 },
+        { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0 },
+        { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 }
+    };
+    static const double C[7] = { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 };
+    static const double E[7] = { 71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0,
+        -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0 };
+    const double h_min = 1.0 / REFINE_MAX_STEPS;
+
+    double k[7][2];
+    if (!refine_rates(ac, atm, seg, 0.0, mass0 - y[1], k[0])) return false;
+
+    double s = 0.0;
+    double h = 0.5;
+    while (s < 1.0) {
+        h = min(h, 1.0 - s);
+
+        // Стадии 2..7; седьмая - в новой точке и служит первой для следующего шага
+        double y_new[2];
+        bool ok = true;
+        for (int st = 1; st < 7 && ok; st++) {
+            for (int c = 0; c < 2; c++) {
+                double sum = 0.0;
+                for (int m = 0; m < st; m++) sum += A[st - 1][m] * k[m][c];
+                y_new[c] = y[c] + h * sum;
+            }
+            ok = refine_rates(ac, atm, seg, s + C[st] * h, mass0 - y_new[1], k[st]);
+        }
+
+        double err = 1e9;
+        if (ok) {
+            err = 0.0;
+            for (int c = 0; c < 2; c++) {
+                double e = 0.0;
+                for (int m = 0; m < 7; m++) e += E[m] * k[m][c];
+                double scale = REFINE_ATOL + REFINE_RTOL * max(fabs(y[c]), fabs(y_new[c]));
+                err = max(err, fabs(h * e) / scale);
+            }
+        }
+
+        if (ok && (err <= 1.0 || h <= h_min)) {
+            s = (h == 1.0 - s) ? 1.0 : s + h;
+            y[0] = y_new[0];
+            y[1] = y_new[1];
+            k[0][0] = k[6][0];
+            k[0][1] = k[6][1];
+            push_refine_point(trace, seg, s, segment, mass0, y);
+        }
+        else {
+            if (!ok && h <= h_min) return false;
+            rejected++;
+        }
+
+        double factor = ok ? 0.9 * pow(max(err, 1e-10), -0.2) : 0.25;
+        h = max(h * min(5.0, max(0.2, factor)), h_min);
+    }
+    return true;
+}
+
+// Пересчет пути решения; точки шагов - в ws.refine, итоги - в trajectory.refine.
+// Участок, который не удалось проинтегрировать (маневр становится
+// невозможным внутри участка), берется из ДП и учитывается в failed_segments.
+void refine_trajectory(const Scenario& sc, SolveWorkspace& ws, TrajectoryResult& trajectory) {
+    const vector<pair<double, double> >& path = trajectory.path;
+    RefineTrace& trace = ws.refine;
+    RefineSummary& summary = trajectory.refine;
+
+    size_t capacity = (path.size() - 1) * (REFINE_MAX_STEPS + 1) + 1;
+    if (trace.time.size() < capacity) {
+        trace.time.resize(capacity);
+        trace.H.resize(capacity);
+        trace.V_kmh.resize(capacity);
+        trace.mass.resize(capacity);
+        trace.fuel.resize(capacity);
+        trace.segment.resize(capacity);
+    }
+
+    summary.done = true;
+    summary.max_segment_deviation = 0.0;
+    summary.rejected_steps = 0;
+    summary.failed_segments = 0;
+
+    // Участки длиннее шага сетки - переходы A* на несколько ячеек
+    double dH_step = ws.H_grid[1] - ws.H_grid[0];
+    double dV_step = ws.V_grid_ms[1] - ws.V_grid_ms[0];
+
+    double y[2] = { 0.0, 0.0 };
+    RefineSegment seg;
+    seg.H1 = path[0].first;
+    seg.dH = 0.0;
+    seg.V1 = path[0].second / 3.6;
+    seg.dV = 0.0;
+    trace.count = 0;
+    push_refine_point(trace, seg, 0.0, 0, sc.mass, y);
+
+    for (size_t k = 1; k < path.size(); k++) {
+        double seg_time = trajectory.segment_times[k - 1];
+        double seg_fuel = trajectory.segment_fuels[k - 1];
+
+        seg.maneuver = trajectory.maneuvers[k];
+        seg.H1 = path[k - 1].first;
+        seg.dH = path[k].first - seg.H1;
+        seg.V1 = path[k - 1].second / 3.6;
+        seg.dV = path[k].second / 3.6 - seg.V1;
+        seg.max_vy_factor = seg.maneuver == SNIZHENIE ? 1.0 : ws.grid.max_vy_factor;
+        seg.dHe = seg.dH + ((seg.V1 + seg.dV) * (seg.V1 + seg.dV) - seg.V1 * seg.V1) / (2.0 * G) -
+            (seg.V1 + 0.5 * seg.dV) * (atmosphere_wind(*sc.atmosphere, seg.H1 + seg.dH) - atmosphere_wind(*sc.atmosphere, seg.H1)) / G;
+        seg.lane_rates = fabs(seg.dH) > 1.5 * dH_step || fabs(seg.dV) > 1.5 * dV_step;
+        if (seg.maneuver == RAZGON_PODIEM) {
+            seg.dt_kinematic = max(seg.dH / 5.0, fabs(seg.dV * 3.6) / 15.0);
+        }
+        else {
+            seg.dt_kinematic = max(fabs(seg.dH) / (MAX_VERTICAL_SPEED * seg.max_vy_factor), fabs(seg.dV) / (15.0 / 3.6));
+        }
+        // Режим, выбранный решателем для участка
+        seg.ps = make_power_setting(trajectory.segment_powers[k - 1]);
+
+        double start[2] = { y[0], y[1] };
+        size_t mark = trace.count;
+        if (!integrate_segment(*sc.aircraft, *sc.atmosphere, seg, (int)k, sc.mass, y, trace, summary.rejected_steps)) {
+            trace.count = mark;
+            y[0] = start[0] + seg_time;
+            y[1] = start[1] + seg_fuel;
+            push_refine_point(trace, seg, 1.0, (int)k, sc.mass, y);
+            summary.failed_segments++;
+        }
+
+        double deviation = max(fabs(y[0] - start[0] - seg_time) / seg_time,
+            fabs(y[1] - start[1] - seg_fuel) / seg_fuel);
+        summary.max_segment_deviation = max(summary.max_segment_deviation, 100.0 * deviation);
+    }
+
+    summary.time = y[0];
+    summary.fuel = y[1];
+    summary.steps = (int)trace.count - 1;
+}
+
+// Решение задачи без вывода на экран и в файлы; таблицы остаются в ws,
+// результат записывается в trajectory (ее векторы используются повторно)
+bool optimize_trajectory(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws,
+    TrajectoryResult& trajectory) {
+    reset_trajectory(trajectory, sc.name);
+
+    ws.c2f.level_n.clear();
+    ws.c2f.level_cost.clear();
+    ws.searched = options.best_first;
+
+    bool found;
+    if (options.best_first) {
+        setup_grid(sc, options.n, ws, options.continuous_power);
+        found = solve_best_first(options, ws, trajectory);
+    }
+    else if (options.coarse_n > 0 && options.coarse_n < options.n && !options.mass_aware) {
+        found = solve_coarse_to_fine(sc, options, ws, trajectory);
+    }
+    else {
+        setup_grid(sc, options.n, ws, options.continuous_power);
+        if (options.edge_cache != NULL && !options.mass_aware) {
+            attach_edge_cache(*options.edge_cache, sc, options, ws);
+        }
+        found = solve_grid(options, ws, trajectory, NULL);
+    }
+
+    if (found) {
+        finish_trajectory(sc, trajectory);
+        if (options.refine) {
+            refine_trajectory(sc, ws, trajectory);
+        }
+    }
+    return found;
+}
+
+TrajectoryResult optimize_trajectory(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws) {
+    TrajectoryResult trajectory;
+    optimize_trajectory(sc, options, ws, trajectory);
+    return trajectory;
+}
+
+// Индекс узла равномерной сетки grid[0..n], совпадающего с value; false - такого нет
+bool find_grid_node(const double* grid, int n, double value, int& index) {
+    double step = (grid[n] - grid[0]) / n;
+    double k = floor((value - grid[0]) / step + 0.5);
+    if (!(k >= 0 && k <= n)) return false;
+    index = (int)k;
+    return fabs(grid[index] - value) <= 1e-6 * fabs(step);
+}
+
+bool find_grid_node(const vector<double>& grid, double value, int& index) {
+    return find_grid_node(grid.data(), (int)grid.size() - 1, value, index);
+}
+
+// Таблицы решения в ws годятся для пути в любой узел: полный ДП или метки
+// массы. В потоковом режиме значения есть только у последней строки,
+// A* закрывает не все узлы, а коридор - обход не всей сетки.
+bool can_trace_any_node(const SolverOptions& options, const SolveWorkspace& ws) {
+    bool corridor = options.coarse_n > 0 && options.coarse_n < options.n && !options.mass_aware;
+    return !ws.searched && !corridor && (options.mass_aware || !ws.store.streaming());
+}
+
+// Путь в узел (ti, tj) по таблицам уже выполненного решения, без обхода.
+// sc - постановка с конечной точкой в этом узле (для средней Vy и уточнения).
+bool trace_grid_node(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws, int ti, int tj,
+    TrajectoryResult& trajectory) {
+    reset_trajectory(trajectory, sc.name);
+    if (ti == 0 && tj == 0) return false;
+
+    bool found = false;
+    if (options.mass_aware) {
+        found = trace_mass_labels(ws, ti, tj, trajectory);
+    }
+    else {
+        with_objective(ws.grid, [&](const auto& objective) {
+            found = trace_store(ws, ti, tj, trajectory, objective);
+        });
+    }
+
+    if (found) {
+        finish_trajectory(sc, trajectory);
+        if (options.refine) {
+            refine_trajectory(sc, ws, trajectory);
+        }
+    }
+    return found;
+}
+
+// Узлы сетки ws, через которые проходит путь решения; false - точка пути не узел
+bool path_grid_nodes(const SolveWorkspace& ws, const TrajectoryResult& trajectory, vector<pair<int, int> >& nodes) {
+    nodes.clear();
+    for (size_t k = 0; k < trajectory.path.size(); k++) {
+        int i, j;
+        if (!find_grid_node(ws.H_grid, trajectory.path[k].first, i) ||
+            !find_grid_node(ws.V_grid_kmh, trajectory.path[k].second, j)) {
+            return false;
+        }
+        nodes.push_back(make_pair(i, j));
+    }
+    return nodes.size() > 1;
+}
+
+// Время и топливо заданного пути (узлы сетки options.n) в постановке sc:
+// профиль H и V прежний, режим двигателей на каждом участке - лучший
+// по критерию sc. С учетом массы масса участка уменьшается на топливо
+// предыдущих. false - какой-то участок в этой постановке невозможен.
+bool evaluate_path(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws,
+    const vector<pair<int, int> >& nodes, double& time, double& fuel) {
+    setup_grid(sc, options.n, ws, options.continuous_power);
+    SweepGrid g = ws.grid;
+    PowerSetting idle = make_power_setting(IDLE_POWER);
+
+    time = 0.0;
+    fuel = 0.0;
+    bool valid = true;
+    with_objective(g, [&](const auto& objective) {
+        for (size_t k = 1; k < nodes.size() && valid; k++) {
+            int i1 = nodes[k - 1].first, j1 = nodes[k - 1].second;
+            int i2 = nodes[k].first, j2 = nodes[k].second;
+            int maneuver = move_maneuver(ws.H_grid[i2] - ws.H_grid[i1], ws.V_grid_ms[j2] - ws.V_grid_ms[j1]);
+            if (options.mass_aware) g.mass = sc.mass - fuel;
+
+            int setting;
+            SegmentData seg = best_move(g, i1, j1, i2, j2, maneuver, idle, objective, setting);
+            valid = seg.valid;
+            time += seg.time;
+            fuel += seg.fuel;
+        }
+    });
+    return valid;
+}
+
+// Резервирует память рабочей области под сетки до max_n x max_n
+// в режиме options, чтобы решения с n <= max_n ее не выделяли
+void reserve_workspace(SolveWorkspace& ws, int max_n, const SolverOptions& options) {
+    size_t points = (size_t)max_n + 1;
+    ws.H_grid.reserve(points);
+    ws.V_grid_kmh.reserve(points);
+    ws.V_grid_ms.reserve(points);
+    size_t settings = options.continuous_power ? POWER_LATTICE_STEPS + MAX_POWER_SETTINGS : MAX_POWER_SETTINGS;
+    ws.power_settings.reserve(settings);
+    ws.physics.altitude.reserve(2 * points - 1);
+    ws.physics.settings.reserve(settings);
+    size_t blocks = (MAX_POWER_SETTINGS + PS_LANES - 1) / PS_LANES;
+    ws.physics.lanes.reserve(blocks);
+    ws.store.reserve(max_n, options.streaming);
+    if (options.streaming) {
+        ws.razgon.segs.reserve(points * blocks);
+        ws.razgon.first.reserve(points * blocks);
+    }
+
+    if (options.refine) {
+        // Путь ДП по сетке n x n - не больше 2n участков
+        size_t capacity = 2 * (size_t)max_n * (REFINE_MAX_STEPS + 1) + 1;
+        ws.refine.time.reserve(capacity);
+        ws.refine.H.reserve(capacity);
+        ws.refine.V_kmh.reserve(capacity);
+        ws.refine.mass.reserve(capacity);
+        ws.refine.fuel.reserve(capacity);
+        ws.refine.segment.reserve(capacity);
+    }
+}
+
+// Оптимизатор для многократных решений из долгоживущего процесса
+// (например, сервиса планирования). Рабочая область выделяется один раз
+// под сетку max_n x max_n; повторные решения полным или потоковым ДП,
+// в том числе с уточнением RK45, память не выделяют, если результат
+// передается тот же. На экран и в файлы ничего не выводится.
+// Экземпляр не потокобезопасен: запросы обрабатываются параллельно
+// отдельными оптимизаторами, по одному на поток (пул в options не нужен).
+// A*, метки массы и решение по коридору тоже работают, но выделяют
+// свои буферы на каждом решении.
+class TrajectoryOptimizer {
+public:
+    TrajectoryOptimizer(int max_n, const SolverOptions& options)
+        : max_grid_n(max(1, max_n)), solver(options), solved(), has_solution(false) {
+        solver.n = min(max(1, solver.n), max_grid_n);
+        reserve_workspace(ws, max_grid_n, solver);
+    }
+
+    int max_n() const {
+        return max_grid_n;
+    }
+
+    const SolverOptions& options() const {
+        return solver;
+    }
+
+    // Сетка следующих решений; false, если n вне 1..max_n
+    bool set_grid(int n) {
+        if (n < 1 || n > max_grid_n) return false;
+        solver.n = n;
+        return true;
+    }
+
+    // Результат с памятью под путь на сетке max_n; его стоит передавать
+    // в solve повторно
+    TrajectoryResult make_result() const {
+        size_t points = 2 * (size_t)max_grid_n + 1;
+        TrajectoryResult trajectory;
+        reset_trajectory(trajectory, "");
+        trajectory.path.reserve(points);
+        trajectory.maneuvers.reserve(points);
+        trajectory.segment_times.reserve(points);
+        trajectory.segment_fuels.reserve(points);
+        trajectory.point_masses.reserve(points);
+        trajectory.segment_powers.reserve(points);
+        return trajectory;
+    }
+
+    // false - пути нет (trajectory.found == false) или у сценария нет самолета или атмосферы
+    bool solve(const Scenario& sc, TrajectoryResult& trajectory) {
+        if (sc.aircraft == NULL || sc.atmosphere == NULL) {
+            reset_trajectory(trajectory, sc.name);
+            return false;
+        }
+        solved = sc;
+        has_solution = true;
+        return optimize_trajectory(sc, solver, ws, trajectory);
+    }
+
+    // Та же задача с другой конечной точкой (запросы "что если").
+    // Если точка - узел сетки последнего решения и его таблицы покрывают
+    // всю сетку (полный ДП или метки массы), путь восстанавливается из них
+    // без обхода, за время порядка длины пути; шаги сетки при этом
+    // прежние. Иначе задача решается заново (reused = false).
+    bool retarget(double H_finish, double V_finish_kmh, TrajectoryResult& trajectory, bool* reused = NULL) {
+        if (reused != NULL) *reused = false;
+        if (!has_solution) {
+            reset_trajectory(trajectory, "");
+            return false;
+        }
+
+        Scenario target = solved;
+        target.H_finish = H_finish;
+        target.V_finish_kmh = V_finish_kmh;
+
+        int ti, tj;
+        if (can_trace_any_node(solver, ws) && solver.n == (int)ws.H_grid.size() - 1 &&
+            find_grid_node(ws.H_grid, H_finish, ti) && find_grid_node(ws.V_grid_kmh, V_finish_kmh, tj)) {
+            if (reused != NULL) *reused = true;
+            return trace_grid_node(target, solver, ws, ti, tj, trajectory);
+        }
+        return solve(target, trajectory);
+    }
+
+    TrajectoryResult solve(const Scenario& sc) {
+        TrajectoryResult trajectory;
+        solve(sc, trajectory);
+        return trajectory;
+    }
+
+    // Заданный путь в постановке sc без оптимизации (evaluate_path).
+    // Сетка и физика в ws заменяются, поэтому retarget после этого
+    // решает задачу заново.
+    bool evaluate(const Scenario& sc, const vector<pair<int, int> >& nodes, double& time, double& fuel) {
+        has_solution = false;
+        if (sc.aircraft == NULL || sc.atmosphere == NULL) return false;
+        return evaluate_path(sc, solver, ws, nodes, time, fuel);
+    }
+
+    // Таблицы и сетка последнего решения (для отчетов и файлов)
+    const SolveWorkspace& workspace() const {
+        return ws;
+    }
+
+private:
+    int max_grid_n;
+    SolverOptions solver;
+    SolveWorkspace ws;
+    Scenario solved;  // постановка, чьи таблицы лежат в ws
+    bool has_solution;
+};
+
+// Серия решений для значений CI на одной сетке. Участки при постоянной
+// массе от CI не зависят, поэтому берутся из кэша ребер (общего, если он
+// задан, иначе временного); если таблица слишком велика, каждое решение
+// считает физику заново.
+vector<TrajectoryResult> optimize_cost_index_sweep(const Scenario& sc, const vector<double>& ci_values,
+    const SolverOptions& options, SolveWorkspace& ws) {
+    Scenario cost_sc = sc;
+    cost_sc.criterion = MIN_COST;
+    setup_grid(cost_sc, options.n, ws, options.continuous_power);
+
+    EdgeCache local_cache;
+    if (!options.mass_aware) {
+        attach_edge_cache(options.edge_cache != NULL ? *options.edge_cache : local_cache, cost_sc, options, ws);
+    }
+
+    vector<TrajectoryResult> results;
+    for (size_t k = 0; k < ci_values.size(); k++) {
+        cost_sc.cost_index = ci_values[k];
+        ws.grid.cost_index = ci_values[k];
+
+        TrajectoryResult trajectory = empty_trajectory(sc.name);
+        if (solve_grid(options, ws, trajectory, NULL)) {
+            finish_trajectory(cost_sc, trajectory);
+        }
+        results.push_back(trajectory);
+    }
+
+    ws.grid.edges = NULL;
+    return results;
+}
+
+// Запись CSV через большой буфер. Числа форматируются как у ofstream
+// по умолчанию (%g, 6 знаков), но без потоков: to_chars, если он есть
+// в библиотеке, иначе snprintf.
+const size_t CSV_BUFFER_BYTES = 1 << 20;
+
+class CsvWriter {
+public:
+    explicit CsvWriter(const string& path) : out(path.c_str()), buffer(CSV_BUFFER_BYTES), used(0) {}
+
+    ~CsvWriter() {
+        close();
+    }
+
+    CsvWriter& operator<<(double value) {
+        reserve(32);
+#ifdef __cpp_lib_to_chars
+        used = to_chars(&buffer[used], &buffer[used] + 32, value, chars_format::general, 6).ptr - &buffer[0];
+#else
+        used += snprintf(&buffer[used], 32, "%g", value);
+#endif
+        return *this;
+    }
+
+    CsvWriter& operator<<(int value) {
+        reserve(24);
+        used += snprintf(&buffer[used], 24, "%d", value);
+        return *this;
+    }
+
+    CsvWriter& operator<<(size_t value) {
+        reserve(24);
+        used += snprintf(&buffer[used], 24, "%llu", (unsigned long long)value);
+        return *this;
+    }
+
+    CsvWriter& operator<<(char c) {
+        reserve(1);
+        buffer[used++] = c;
+        return *this;
+    }
+
+    CsvWriter& operator<<(const string& text) {
+        return write(text.data(), text.size());
+    }
+
+    CsvWriter& operator<<(const char* text) {
+        return write(text, strlen(text));
+    }
+
+    void close() {
+        flush();
+        if (out.is_open()) out.close();
+    }
+
+private:
+    ofstream out;
+    vector<char> buffer;
+    size_t used;
+
+    void flush() {
+        if (used > 0 && out.is_open()) out.write(&buffer[0], used);
+        used = 0;
+    }
+
+    void reserve(size_t bytes) {
+        if (used + bytes > buffer.size()) flush();
+    }
+
+    CsvWriter& write(const char* text, size_t size) {
+        if (size > buffer.size()) {
+            flush();
+            out.write(text, size);
+            return *this;
+        }
+        reserve(size);
+        copy(text, text + size, &buffer[used]);
+        used += size;
+        return *this;
+    }
+};
+
+// Двоичный столбцовый файл (.dzc), который можно отобразить в память:
+//   заголовок: char magic[8] = "DZCOL001", uint32 0x01020304 (порядок байт),
+//              uint32 число столбцов;
+//   описания:  char name[32], uint32 dtype (1 - float64, 2 - int32, 3 - uint8),
+//              uint32 размер элемента, uint64 rows, uint64 cols, uint64 offset;
+//   данные:    столбец - непрерывный массив rows x cols по строкам,
+//              offset от начала файла кратен 64.
+// Недостижимые узлы матриц записываются как NaN.
+const char COLUMN_FILE_MAGIC[8] = { 'D', 'Z', 'C', 'O', 'L', '0', '0', '1' };
+const size_t COLUMN_ALIGN = 64;
+
+enum ColumnType {
+    COLUMN_F64 = 1,
+    COLUMN_I32 = 2,
+    COLUMN_U8 = 3
+};
+
+struct ColumnHeader {
+    char name[32];
+    unsigned int dtype;
+    unsigned int item_bytes;
+    unsigned long long rows;
+    unsigned long long cols;
+    unsigned long long offset;
+};
+
+class ColumnFileWriter {
+public:
+    // mask != NULL: значения, для которых mask >= 1e9, записываются как NaN
+    void add(const string& name, const double* data, size_t rows, size_t cols, const double* mask = NULL) {
+        push(name, COLUMN_F64, sizeof(double), data, rows, cols, mask);
+    }
+
+    void add(const string& name, const int* data, size_t rows, size_t cols) {
+        push(name, COLUMN_I32, sizeof(int), data, rows, cols, NULL);
+    }
+
+    void add(const string& name, const unsigned char* data, size_t rows, size_t cols) {
+        push(name, COLUMN_U8, 1, data, rows, cols, NULL);
+    }
+
+    bool write(const string& path) const {
+        ofstream out(path.c_str(), ios::binary);
+        if (!out) return false;
+
+        unsigned int order = 0x01020304;
+        unsigned int count = (unsigned int)headers.size();
+        out.write(COLUMN_FILE_MAGIC, sizeof(COLUMN_FILE_MAGIC));
+        out.write((const char*)&order, sizeof(order));
+        out.write((const char*)&count, sizeof(count));
+        out.write((const char*)headers.data(), headers.size() * sizeof(ColumnHeader));
+
+        unsigned long long pos = sizeof(COLUMN_FILE_MAGIC) + 2 * sizeof(unsigned int) + headers.size() * sizeof(ColumnHeader);
+        const size_t CHUNK = 8192;
+        vector<double> chunk(CHUNK);
+        for (size_t c = 0; c < headers.size(); c++) {
+            const ColumnHeader& h = headers[c];
+            static const char zeros[COLUMN_ALIGN] = { 0 };
+            out.write(zeros, (streamsize)(h.offset - pos));
+
+            size_t count_items = (size_t)(h.rows * h.cols);
+            if (masks[c] == NULL) {
+                out.write((const char*)data[c], (streamsize)(count_items * h.item_bytes));
+            }
+            else {
+                const double* values = (const double*)data[c];
+                for (size_t first = 0; first < count_items; first += CHUNK) {
+                    size_t n = min(CHUNK, count_items - first);
+                    for (size_t k = 0; k < n; k++) {
+                        chunk[k] = masks[c][first + k] >= 1e9 ? numeric_limits<double>::quiet_NaN() : values[first + k];
+                    }
+                    out.write((const char*)chunk.data(), (streamsize)(n * sizeof(double)));
+                }
+            }
+            pos = h.offset + count_items * h.item_bytes;
+        }
+        return (bool)out;
+    }
+
+private:
+    vector<ColumnHeader> headers;
+    vector<const void*> data;
+    vector<const double*> masks;
+
+    void push(const string& name, unsigned int dtype, unsigned int item_bytes, const void* values,
+        size_t rows, size_t cols, const double* mask) {
+        ColumnHeader h;
+        memset(&h, 0, sizeof(h));
+        name.copy(h.name, sizeof(h.name) - 1);
+        h.dtype = dtype;
+        h.item_bytes = item_bytes;
+        h.rows = rows;
+        h.cols = cols;
+        headers.push_back(h);
+        data.push_back(values);
+        masks.push_back(mask);
+
+        // Смещения пересчитываются при каждом добавлении: таблица описаний растет
+        unsigned long long pos = sizeof(COLUMN_FILE_MAGIC) + 2 * sizeof(unsigned int) + headers.size() * sizeof(ColumnHeader);
+        for (size_t c = 0; c < headers.size(); c++) {
+            pos = (pos + COLUMN_ALIGN - 1) / COLUMN_ALIGN * COLUMN_ALIGN;
+            headers[c].offset = pos;
+            pos += headers[c].rows * headers[c].cols * headers[c].item_bytes;
+        }
+    }
+};
+
+// Сетка, матрицы ДП (в полном режиме), траектория и точки пересчета
+// в одном двоичном файле
+bool write_solution_columns(const string& path, const SolveWorkspace& ws, const TrajectoryResult& trajectory) {
+    const DPStore& store = ws.store;
+    size_t nodes = ws.H_grid.size();
+
+    ColumnFileWriter file;
+    file.add("H_grid", ws.H_grid.data(), nodes, 1);
+    file.add("V_grid_kmh", ws.V_grid_kmh.data(), nodes, 1);
+    if (!store.streaming()) {
+        file.add("time_matrix", store.time_matrix(), nodes, nodes, store.cost_matrix());
+        file.add("fuel_matrix", store.fuel_matrix(), nodes, nodes, store.cost_matrix());
+    }
+
+    // Точка k траектории: маневр и участок, который в нее привел (у старта 0)
+    size_t points = trajectory.path.size();
+    vector<double> path_H(points), path_V(points), seg_time(points, 0.0), seg_fuel(points, 0.0);
+    vector<int> maneuver(points, 0);
+    for (size_t k = 0; k < points; k++) {
+        path_H[k] = trajectory.path[k].first;
+        path_V[k] = trajectory.path[k].second;
+        if (k > 0) {
+            maneuver[k] = trajectory.maneuvers[k];
+            seg_time[k] = trajectory.segment_times[k - 1];
+            seg_fuel[k] = trajectory.segment_fuels[k - 1];
+        }
+    }
+    if (trajectory.found) {
+        file.add("path_H", path_H.data(), points, 1);
+        file.add("path_V_kmh", path_V.data(), points, 1);
+        file.add("path_maneuver", maneuver.data(), points, 1);
+        file.add("segment_time", seg_time.data(), points, 1);
+        file.add("segment_fuel", seg_fuel.data(), points, 1);
+    }
+
+    const RefineTrace& trace = ws.refine;
+    if (trajectory.refine.done) {
+        file.add("refine_time", trace.time.data(), trace.count, 1);
+        file.add("refine_H", trace.H.data(), trace.count, 1);
+        file.add("refine_V_kmh", trace.V_kmh.data(), trace.count, 1);
+        file.add("refine_mass", trace.mass.data(), trace.count, 1);
+        file.add("refine_fuel", trace.fuel.data(), trace.count, 1);
+        file.add("refine_segment", trace.segment.data(), trace.count, 1);
+    }
+    return file.write(path);
+}
+
+// Матрица (n + 1) x (n + 1) полного режима в CSV: строка заголовка
+// со скоростями, затем по строке на высоту; недостижимые узлы пустые
+void write_matrix_csv(const string& path, const SolveWorkspace& ws, const double* values) {
+    const vector<double>& H_grid = ws.H_grid;
+    const vector<double>& V_grid_kmh = ws.V_grid_kmh;
+    const int N = (int)H_grid.size() - 1;
+
+    CsvWriter csv(path);
+    csv << "H/V";
+    for (int j = 0; j <= N; j++) {
+        csv << "," << V_grid_kmh[j];
+    }
+    csv << "\n";
+
+    for (int i = 0; i <= N; i++) {
+        csv << H_grid[i];
+        const double* row = values + (size_t)i * (N + 1);
+        for (int j = 0; j <= N; j++) {
+            csv << ",";
+            if (row[j] < 1e8) {
+                csv << row[j];
+            }
+        }
+        csv << "\n";
+    }
+    csv.close();
+}
+
+void write_trajectory_csv(const string& path, const TrajectoryResult& trajectory) {
+    CsvWriter traj_csv(path);
+    traj_csv << "Point,H_m,V_kmh,Maneuver,Segment_time_s,Segment_fuel_kg\n";
+
+    for (size_t k = 0; k < trajectory.path.size(); k++) {
+        traj_csv << k + 1 << ","
+            << trajectory.path[k].first << ","
+            << trajectory.path[k].second << ",";
+
+        if (k == 0) {
+            traj_csv << "START,0,0";
+        }
+        else {
+            traj_csv << maneuver_name(trajectory.maneuvers[k]) << ","
+                << trajectory.segment_times[k - 1] << ","
+                << trajectory.segment_fuels[k - 1];
+        }
+        traj_csv << "\n";
+    }
+    traj_csv.close();
+}
+
+// Файл, отображенный в память только для чтения
+class MappedFile {
+public:
+    MappedFile() : base(NULL), bytes(0) {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER file_size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+        if (mapping != NULL) {
+            base = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            bytes = base != NULL ? (size_t)file_size.QuadPart : 0;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (view != MAP_FAILED) {
+                base = (const unsigned char*)view;
+                bytes = (size_t)info.st_size;
+            }
+        }
+        ::close(fd);
+#endif
+        return base != NULL;
+    }
+
+    void close() {
+        if (base == NULL) return;
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+#else
+        munmap((void*)base, bytes);
+#endif
+        base = NULL;
+        bytes = 0;
+    }
+
+    const unsigned char* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return bytes;
+    }
+
+private:
+    const unsigned char* base;
+    size_t bytes;
+};
+
+// Столбец name из отображенного файла .dzc с заданным типом и размерами;
+// NULL, если его нет или описание выходит за границы файла
+const void* find_column(const MappedFile& file, const char* name, unsigned int dtype, size_t rows, size_t cols) {
+    const unsigned char* base = file.data();
+    size_t head = sizeof(COLUMN_FILE_MAGIC) + 2 * sizeof(unsigned int);
+    if (base == NULL || file.size() < head || memcmp(base, COLUMN_FILE_MAGIC, sizeof(COLUMN_FILE_MAGIC)) != 0) {
+        return NULL;
+    }
+
+    unsigned int order, count;
+    memcpy(&order, base + sizeof(COLUMN_FILE_MAGIC), sizeof(order));
+    memcpy(&count, base + sizeof(COLUMN_FILE_MAGIC) + sizeof(order), sizeof(count));
+    if (order != 0x01020304 || count > (file.size() - head) / sizeof(ColumnHeader)) return NULL;
+
+    for (unsigned int c = 0; c < count; c++) {
+        ColumnHeader h;
+        memcpy(&h, base + head + c * sizeof(ColumnHeader), sizeof(h));
+        h.name[sizeof(h.name) - 1] = '\0';
+        if (strcmp(h.name, name) != 0) continue;
+
+        if (h.dtype != dtype || h.rows != rows || h.cols != cols || h.offset % COLUMN_ALIGN != 0 ||
+            h.offset > file.size() || h.rows * h.cols * h.item_bytes > file.size() - h.offset) {
+            return NULL;
+        }
+        return base + h.offset;
+    }
+    return NULL;
+}
+
+// Постановка в столбце "scenario" таблицы конечных точек
+const int ENDPOINT_SCENARIO_SIZE = 7;
+
+// Ответы для всех конечных точек по одному обходу. Полный ДП уже хранит
+// для каждого узла лучшие время и топливо от старта и код последнего
+// маневра; этого хватает, чтобы восстановить путь в любой узел сетки
+// за время порядка длины пути. Таблица пишется в файл .dzc (сетка,
+// постановка, time_matrix и fuel_matrix с NaN в недостижимых узлах,
+// code_matrix по байту на узел) и читается через отображение в память.
+bool write_endpoint_table(const string& path, const Scenario& sc, const SolveWorkspace& ws) {
+    const DPStore& store = ws.store;
+    size_t nodes = ws.H_grid.size();
+    double scenario[ENDPOINT_SCENARIO_SIZE] = {
+        sc.mass, sc.H_start, sc.H_finish, sc.V_start_kmh, sc.V_finish_kmh, (double)sc.criterion, sc.cost_index
+    };
+
+    ColumnFileWriter file;
+    file.add("H_grid", ws.H_grid.data(), nodes, 1);
+    file.add("V_grid_kmh", ws.V_grid_kmh.data(), nodes, 1);
+    file.add("scenario", scenario, ENDPOINT_SCENARIO_SIZE, 1);
+    file.add("time_matrix", store.time_matrix(), nodes, nodes, store.cost_matrix());
+    file.add("fuel_matrix", store.fuel_matrix(), nodes, nodes, store.cost_matrix());
+    file.add("code_matrix", store.code_matrix(), nodes, nodes);
+    return file.write(path);
+}
+
+class EndpointTable {
+public:
+    EndpointTable() : grid_n(0) {}
+
+    // false - файла нет или это не таблица конечных точек
+    bool open(const string& path) {
+        grid_n = 0;
+        if (!file.open(path) || file.size() < sizeof(COLUMN_FILE_MAGIC) + 2 * sizeof(unsigned int)) return false;
+
+        // Размер сетки - по описанию столбца H_grid
+        size_t head = sizeof(COLUMN_FILE_MAGIC) + 2 * sizeof(unsigned int);
+        unsigned int count;
+        memcpy(&count, file.data() + sizeof(COLUMN_FILE_MAGIC) + sizeof(unsigned int), sizeof(count));
+        unsigned long long nodes = 0;
+        for (unsigned int c = 0; c < count && head + (c + 1) * sizeof(ColumnHeader) <= file.size(); c++) {
+            ColumnHeader h;
+            memcpy(&h, file.data() + head + c * sizeof(ColumnHeader), sizeof(h));
+            if (strncmp(h.name, "H_grid", sizeof(h.name)) == 0) nodes = h.rows;
+        }
+        if (nodes < 2 || nodes > (unsigned long long)MAX_N + 1) return false;
+
+        H = (const double*)find_column(file, "H_grid", COLUMN_F64, nodes, 1);
+        V = (const double*)find_column(file, "V_grid_kmh", COLUMN_F64, nodes, 1);
+        const double* scenario = (const double*)find_column(file, "scenario", COLUMN_F64, ENDPOINT_SCENARIO_SIZE, 1);
+        time = (const double*)find_column(file, "time_matrix", COLUMN_F64, nodes, nodes);
+        fuel = (const double*)find_column(file, "fuel_matrix", COLUMN_F64, nodes, nodes);
+        code = (const unsigned char*)find_column(file, "code_matrix", COLUMN_U8, nodes, nodes);
+        if (H == NULL || V == NULL || scenario == NULL || time == NULL || fuel == NULL || code == NULL) return false;
+
+        base.name = path;
+        base.aircraft = NULL;
+        base.atmosphere = NULL;
+        base.mass = scenario[0];
+        base.H_start = scenario[1];
+        base.H_finish = scenario[2];
+        base.V_start_kmh = scenario[3];
+        base.V_finish_kmh = scenario[4];
+        base.criterion = (OptimizationCriterion)(int)scenario[5];
+        base.cost_index = scenario[6];
+        grid_n = (int)nodes - 1;
+        return true;
+    }
+
+    int n() const {
+        return grid_n;
+    }
+
+    // Постановка, для которой построена таблица (без самолета)
+    const Scenario& scenario() const {
+        return base;
+    }
+
+    // Узел сетки в точке (H, V_kmh); false - такого узла нет
+    bool find_node(double H_finish, double V_finish_kmh, int& ti, int& tj) const {
+        return grid_n > 0 && find_grid_node(H, grid_n, H_finish, ti) && find_grid_node(V, grid_n, V_finish_kmh, tj);
+    }
+
+    // Путь в конечную точку (H, V_kmh); false - точка не узел сетки или недостижима.
+    // Для стартового узла путь - одна точка с нулевыми итогами.
+    bool query(double H_finish, double V_finish_kmh, TrajectoryResult& trajectory) const {
+        int ti, tj;
+        if (!find_node(H_finish, V_finish_kmh, ti, tj)) {
+            reset_trajectory(trajectory, base.name);
+            return false;
+        }
+        return query_node(ti, tj, trajectory);
+    }
+
+    bool query_node(int ti, int tj, TrajectoryResult& trajectory) const {
+        reset_trajectory(trajectory, base.name);
+        const size_t stride = (size_t)grid_n + 1;
+        if (ti < 0 || tj < 0 || ti > grid_n || tj > grid_n || std::isnan(time[ti * stride + tj])) {
+            return false;
+        }
+
+        int ci = ti, cj = tj;
+        while (true) {
+            int c = code[ci * stride + cj];
+            trajectory.path.push_back(make_pair(H[ci], V[cj]));
+            trajectory.maneuvers.push_back(c == 0 ? RAZGON : (ManeuverType)c);
+            if (c == 0 || c > RAZGON_PODIEM) break;
+
+            // Коды из файла не проверены: маневр не должен уводить за край сетки
+            int pi, pj;
+            maneuver_source(c, ci, cj, pi, pj);
+            if (pi < 0 || pj < 0) return false;
+            trajectory.segment_times.push_back(time[ci * stride + cj] - time[pi * stride + pj]);
+            trajectory.segment_fuels.push_back(fuel[ci * stride + cj] - fuel[pi * stride + pj]);
+            ci = pi;
+            cj = pj;
+        }
+        if (ci != 0 || cj != 0) return false;
+
+        trajectory.total_time = time[ti * stride + tj];
+        trajectory.total_fuel = fuel[ti * stride + tj];
+
+        Scenario target = base;
+        target.H_finish = H[ti];
+        target.V_finish_kmh = V[tj];
+        finish_trajectory(target, trajectory);
+        return true;
+    }
+
+private:
+    MappedFile file;
+    int grid_n;
+    Scenario base;
+    const double* H;
+    const double* V;
+    const double* time;
+    const double* fuel;
+    const unsigned char* code;
+};
+
+// Вывод решения на экран и в файлы (CSV и/или двоичный .dzc)
+void report_trajectory(const Scenario& sc, const SolveWorkspace& ws, const TrajectoryResult& trajectory,
+    const SolverOptions& options) {
+    int output = options.output;
+    const DPStore& store = ws.store;
+    const vector<double>& H_grid = ws.H_grid;
+    const vector<double>& V_grid_kmh = ws.V_grid_kmh;
+    const int N = (int)H_grid.size() - 1;
+
+    // Сохраняем матрицы в CSV файлы
+    string suffix = (sc.criterion == MIN_TIME) ? "min_time" : (sc.criterion == MIN_FUEL) ? "min_fuel" : criterion_label(sc);
+
+    bool binary = (output & OUTPUT_BINARY) != 0;
+    bool csv_matrices = (output & OUTPUT_CSV) != 0 && !store.streaming();
+    if (binary && !write_solution_columns("solution_" + suffix + ".dzc", ws, trajectory)) {
+        cout << "OSHIBKA: ne udalos zapisat fail solution_" << suffix << ".dzc\n";
+    }
+
+    // В потоковом режиме полных матриц нет, сохраняется только траектория
+    if (csv_matrices) {
+        write_matrix_csv("time_matrix_" + suffix + ".csv", ws, store.time_matrix());
+        write_matrix_csv("fuel_matrix_" + suffix + ".csv", ws, store.fuel_matrix());
+    }
+    else if (store.streaming()) {
+        cout << "Potokovyi rezhim: matricy vremeni i topliva ne sokhranyayutsya\n\n";
+    }
+
+    if (!trajectory.found) {
+        cout << "OSHIBKA: Ne naiden put!\n";
+        return;
+    }
+
+    const vector<pair<double, double> >& path = trajectory.path;
+    const vector<ManeuverType>& path_maneuvers = trajectory.maneuvers;
+    const vector<double>& seg_times = trajectory.segment_times;
+    const vector<double>& seg_fuels = trajectory.segment_fuels;
+
+    // CSV траектории пишется всегда: по нему строятся графики gnuplot
+    write_trajectory_csv("trajectory_" + suffix + ".csv", trajectory);
+
+    // В тихом режиме матрицы и таблица пути на экран не выводятся
+    if (!store.streaming() && !options.quiet) {
+        // Вывод матрицы времени
+        cout << "Matrica vremeni (s):\n";
+        cout << "     V->";
+        for (int j = 0; j <= N; j++) {
+            cout << setw(7) << (int)V_grid_kmh[j];
+        }
+        cout << "\nH\n";
+        for (int i = 0; i <= N; i++) {
+            cout << setw(5) << (int)H_grid[i];
+            for (int j = 0; j <= N; j++) {
+                if (store.time_at(i, j) < 1e8) {
+                    cout << setw(7) << (int)store.time_at(i, j);
+                }
+                else {
+                    cout << setw(7) << "---";
+                }
+            }
+            cout << "\n";
+        }
+
+        // Вывод матрицы топлива
+        cout << "\nMatrica raskhoda topliva (kg):\n";
+        cout << "     V->";
+        for (int j = 0; j <= N; j++) {
+            cout << setw(7) << (int)V_grid_kmh[j];
+        }
+        cout << "\nH\n";
+        for (int i = 0; i <= N; i++) {
+            cout << setw(5) << (int)H_grid[i];
+            for (int j = 0; j <= N; j++) {
+                if (store.fuel_at(i, j) < 1e8) {
+                    cout << setw(7) << (int)store.fuel_at(i, j);
+                }
+                else {
+                    cout << setw(7) << "---";
+                }
+            }
+            cout << "\n";
+        }
+        cout << "\n";
+    }
+
+    for (size_t k = 0; k < path.size() && !options.quiet; k++) {
+        if (k == 0) {
+            cout << "Optimalnaya traektoriya:\n";
+            cout << "-------------------------------------------------------------\n";
+            cout << "Tochka\tH (m)\t\tV (km/h)\tManevr\t\tVremya\tToplivo\n";
+            cout << "-------------------------------------------------------------\n";
+        }
+
+        cout << k + 1 << "\t" << fixed << setprecision(1)
+            << setw(8) << path[k].first
+            << "\t" << setw(8) << path[k].second << "\t";
+
+        if (k > 0) {
+            if (path_maneuvers[k] == RAZGON) cout << "Razgon\t\t";
+            else if (path_maneuvers[k] == PODIEM) cout << "Podiem\t\t";
+            else if (path_maneuvers[k] == RAZGON_PODIEM) cout << "Raz+Pod\t\t";
+            else if (path_maneuvers[k] == TORMOZHENIE) cout << "Tormozh\t\t";
+            else if (path_maneuvers[k] == SNIZHENIE) cout << "Snizh\t\t";
+            else if (path_maneuvers[k] == OBMEN_ENERGII) cout << "Obmen\t\t";
+
+            cout << setw(6) << seg_times[k - 1] << "\t"
+                << setw(6) << seg_fuels[k - 1];
+        }
+        else {
+            cout << "Start\t\t0\t0";
+        }
+        cout << "\n";
+    }
+
+    cout << "\n=============================================\n";
+    cout << "Ispolzovano v traektorii:\n";
+    cout << "- Razgon: " << trajectory.used_razgon << " raz\n";
+    cout << "- Podiem: " << trajectory.used_podiem << " raz\n";
+    cout << "- Razgon+Podiem: " << trajectory.used_combined << " raz\n";
+    if (trajectory.used_reverse > 0) {
+        cout << "- Tormozhenie/Snizhenie/Obmen: " << trajectory.used_reverse << " raz\n";
+    }
+    cout << "---------------------------------------------\n";
+    cout << fixed << setprecision(2);
+    cout << "Vremya manevra:     " << trajectory.total_time << " s  ("
+        << trajectory.total_time / 60.0 << " min)\n";
+    cout << "Raskhod topliva:    " << trajectory.total_fuel << " kg\n";
+    if (!trajectory.point_masses.empty()) {
+        cout << "Konechnaya massa:   " << trajectory.point_masses.back() << " kg\n";
+    }
+
+    double avg_climb_rate = trajectory.avg_vy;
+
+    cout << "Srednyaya Vy:       " << avg_climb_rate << " m/s  ("
+        << avg_climb_rate * 60.0 << " m/min)\n";
+
+    if (ws.searched) {
+        double cells = ((double)N + 1.0) * ((double)N + 1.0);
+        cout << "---------------------------------------------\n";
+        cout << "Poisk A*: raskryto uzlov " << ws.search.expanded << " iz " << (long long)cells << " ("
+            << 100.0 * ws.search.expanded / cells << "%), uchastkov " << ws.search.edges << "\n";
+    }
+
+    const RefineSummary& refine = trajectory.refine;
+    if (refine.done) {
+        const RefineTrace& trace = ws.refine;
+        CsvWriter refine_csv("trajectory_refined_" + suffix + ".csv");
+        refine_csv << "Step,Segment,Time_s,H_m,V_kmh,Mass_kg,Fuel_kg\n";
+        for (size_t p = 0; p < trace.count; p++) {
+            refine_csv << p << "," << trace.segment[p] << "," << trace.time[p] << "," << trace.H[p] << ","
+                << trace.V_kmh[p] << "," << trace.mass[p] << "," << trace.fuel[p] << "\n";
+        }
+        refine_csv.close();
+
+        cout << "---------------------------------------------\n";
+        cout << "Utochnenie RK45: shagov " << refine.steps << ", otbrosheno " << refine.rejected_steps << "\n";
+        cout << "Vremya:             " << refine.time << " s  (DP: "
+            << 100.0 * (trajectory.total_time - refine.time) / refine.time << "%)\n";
+        cout << "Toplivo:            " << refine.fuel << " kg  (DP: "
+            << 100.0 * (trajectory.total_fuel - refine.fuel) / refine.fuel << "%)\n";
+        cout << "Konechnaya massa:   " << sc.mass - refine.fuel << " kg\n";
+        cout << "Maks. otklonenie uchastka: " << refine.max_segment_deviation << "%\n";
+        if (refine.failed_segments > 0) {
+            cout << "VNIMANIE: " << refine.failed_segments
+                << " uchastkov ne prointegrirovano, vzyaty znacheniya DP\n";
+        }
+    }
+
+    const CorridorReport& c2f = ws.c2f;
+    if (!c2f.level_n.empty()) {
+        double full_cells = ((double)N + 1.0) * ((double)N + 1.0);
+        cout << "---------------------------------------------\n";
+        cout << "Ot gruboi setki k tochnoi (koridor +-" << c2f.halfwidth << " uzlov):\n";
+        for (size_t k = 0; k < c2f.level_n.size(); k++) {
+            cout << "- setka " << c2f.level_n[k] << ": stoimost " << c2f.level_cost[k] << "\n";
+        }
+        cout << "Poschitano uzlov:   " << (long long)c2f.cells << " iz " << (long long)full_cells << " ("
+            << 100.0 * c2f.cells / full_cells << "% polnoi setki)\n";
+        if (c2f.level_cost.size() > 1) {
+            double last = c2f.level_cost.back();
+            double prev = c2f.level_cost[c2f.level_cost.size() - 2];
+            cout << "Izmenenie na poslednem urovne: " << 100.0 * fabs(last - prev) / last << "%\n";
+        }
+        if (c2f.touches_boundary) {
+            cout << "VNIMANIE: put kasaetsya granicy koridora, uvelichte --corridor\n";
+        }
+    }
+
+    cout << "\nFiles created:\n";
+    cout << "- trajectory_" << suffix << ".csv\n";
+    if (csv_matrices) {
+        cout << "- time_matrix_" << suffix << ".csv\n";
+        cout << "- fuel_matrix_" << suffix << ".csv\n";
+    }
+    if (binary) {
+        cout << "- solution_" << suffix << ".dzc\n";
+    }
+    if (refine.done) {
+        cout << "- trajectory_refined_" << suffix << ".csv\n";
+    }
+    cout << "=============================================\n";
+
+}
+
+TrajectoryResult solve_trajectory(OptimizationCriterion criterion, string traj_name, const SolverOptions& options,
+    const AircraftModel& aircraft, const UniformAtmosphere& atmosphere) {
+    cout << "\n========================================\n";
+    if (criterion == MIN_TIME) {
+        cout << "KRITERII: MINIMIZACIA VREMENI (" << traj_name << ")\n";
+    }
+    else {
+        cout << "KRITERII: MINIMIZACIA TOPLIVA (" << traj_name << ")\n";
+    }
+    cout << "========================================\n\n";
+
+    Scenario sc = default_scenario(criterion, traj_name, aircraft, atmosphere);
+    SolveWorkspace ws;
+    TrajectoryResult trajectory = optimize_trajectory(sc, options, ws);
+    report_trajectory(sc, ws, trajectory, options);
+
+    // Проверка точности коридора по полному решению
+    if (options.corridor_check && !ws.c2f.level_n.empty() && trajectory.found) {
+        SolverOptions full = options;
+        full.coarse_n = 0;
+        SolveWorkspace full_ws;
+        TrajectoryResult reference = optimize_trajectory(sc, full, full_ws);
+        if (reference.found) {
+            double cost = trajectory_cost(sc, trajectory);
+            double reference_cost = trajectory_cost(sc, reference);
+            cout << "Polnoe reshenie:    " << reference_cost << ", otklonenie koridora: "
+                << 100.0 * (cost - reference_cost) / reference_cost << "%\n";
+        }
+    }
+
+    // Проверка оценки A*: тот же поиск с нулевой оценкой (Дейкстра)
+    // дает точный минимум на графе переходов; A* не должен быть дороже
+    if (options.search_check && ws.searched && trajectory.found) {
+        const int N = options.n;
+        const int goal = N * (N + 1) + N;
+        SolveWorkspace check_ws;
+        setup_grid(sc, N, check_ws, options.continuous_power);
+        bool found = false;
+        with_objective(check_ws.grid, [&](const auto& objective) {
+            found = search_best_first(check_ws.search, check_ws.grid, check_ws.H_grid, N, options.stencil_reach,
+                options.allow_reverse, false, objective);
+        });
+        if (found) {
+            double cost = ws.search.cost[goal];
+            double reference_cost = check_ws.search.cost[goal];
+            cout << "Poisk bez ocenki:   " << reference_cost << ", otklonenie A*: "
+                << 100.0 * (cost - reference_cost) / reference_cost << "%, raskryto uzlov "
+                << ws.search.expanded << " / " << check_ws.search.expanded << "\n";
+            if (cost > reference_cost * (1.0 + 1e-9)) {
+                cout << "OSHIBKA: ocenka A* ne dopustima - put A* dorozhe tochnogo\n";
+            }
+        }
+    }
+
+    return trajectory;
+}
+
+// Фронт Парето: режимы двигателей обоих критериев на одной сетке
+struct ParetoWorkspace {
+    SolveWorkspace time_ws;
+    SolveWorkspace fuel_ws;
+    vector<double> settings;
+    ParetoLabelStore labels;
+};
+
+// Все недоминируемые траектории в (N, N), от самой быстрой к самой экономичной
+vector<TrajectoryResult> optimize_pareto_front(const Scenario& sc, const SolverOptions& options,
+    ParetoWorkspace& ws) {
+    const int N = options.n;
+    Scenario time_sc = sc;
+    time_sc.criterion = MIN_TIME;
+    Scenario fuel_sc = sc;
+    fuel_sc.criterion = MIN_FUEL;
+    setup_grid(time_sc, N, ws.time_ws, false);
+    setup_grid(fuel_sc, N, ws.fuel_ws, false);
+    if (options.edge_cache != NULL) {
+        attach_edge_cache(*options.edge_cache, time_sc, options, ws.time_ws);
+        attach_edge_cache(*options.edge_cache, fuel_sc, options, ws.fuel_ws);
+    }
+
+    ws.settings = ws.time_ws.power_settings;
+    ws.settings.insert(ws.settings.end(), ws.fuel_ws.power_settings.begin(), ws.fuel_ws.power_settings.end());
+
+    vector<ParetoRegime> regimes(2);
+    regimes[0].grid = &ws.time_ws.grid;
+    regimes[0].first_setting = 0;
+    regimes[1].grid = &ws.fuel_ws.grid;
+    regimes[1].first_setting = (int)ws.time_ws.power_settings.size();
+
+    sweep_pareto(ws.labels, regimes, N, options.pareto_labels,
+        (options.pool != NULL && options.pool->size() > 1) ? options.pool : NULL);
+
+    const ParetoLabelStore& labels = ws.labels;
+    const vector<double>& H_grid = ws.time_ws.H_grid;
+    const vector<double>& V_grid_kmh = ws.time_ws.V_grid_kmh;
+
+    vector<TrajectoryResult> front;
+    int final_count = labels.count[labels.node(N, N)];
+    for (int f = 0; f < final_count; f++) {
+        TrajectoryResult trajectory = empty_trajectory(sc.name);
+
+        int ci = N, cj = N, cl = f;
+        while (true) {
+            const ParetoLabel& label = labels.at(ci, cj)[cl];
+            trajectory.path.push_back(make_pair(H_grid[ci], V_grid_kmh[cj]));
+            trajectory.maneuvers.push_back(label.code == 0 ? RAZGON : (ManeuverType)label.code);
+            if (label.code == 0) break;
+
+            int pi, pj;
+            maneuver_source(label.code, ci, cj, pi, pj);
+            const ParetoLabel& prev = labels.at(pi, pj)[label.prev_label];
+            trajectory.segment_times.push_back(label.time - prev.time);
+            trajectory.segment_fuels.push_back(label.fuel - prev.fuel);
+            trajectory.segment_powers.push_back(ws.settings[label.setting]);
+
+            ci = pi;
+            cj = pj;
+            cl = label.prev_label;
+        }
+
+        trajectory.total_time = labels.at(N, N)[f].time;
+        trajectory.total_fuel = labels.at(N, N)[f].fuel;
+        finish_trajectory(sc, trajectory);
+        front.push_back(trajectory);
+    }
+    return front;
+}
+
+void report_pareto_front(const vector<TrajectoryResult>& front) {
+    if (front.empty()) {
+        cout << "OSHIBKA: Ne naiden put!\n";
+        return;
+    }
+
+    ofstream front_csv("pareto_front.csv");
+    front_csv << "Label,Total_time_s,Total_fuel_kg,Razgon,Podiem,Razgon_Podiem\n";
+    ofstream paths_csv("pareto_paths.csv");
+    paths_csv << "Label,Point,H_m,V_kmh,Maneuver,Power,Segment_time_s,Segment_fuel_kg\n";
+
+    cout << "Front Pareto vremya/toplivo (" << front.size() << " traektorii):\n";
+    cout << "-------------------------------------------------------------\n";
+    cout << "Nomer\tVremya (s)\tToplivo (kg)\tRazgon\tPodiem\tRaz+Pod\n";
+    cout << "-------------------------------------------------------------\n";
+
+    for (size_t f = 0; f < front.size(); f++) {
+        const TrajectoryResult& t = front[f];
+        cout << f + 1 << "\t" << setw(8) << t.total_time << "\t" << setw(8) << t.total_fuel << "\t"
+            << t.used_razgon << "\t" << t.used_podiem << "\t" << t.used_combined << "\n";
+        front_csv << f + 1 << "," << t.total_time << "," << t.total_fuel << ","
+            << t.used_razgon << "," << t.used_podiem << "," << t.used_combined << "\n";
+
+        for (size_t k = 0; k < t.path.size(); k++) {
+            paths_csv << f + 1 << "," << k + 1 << "," << t.path[k].first << "," << t.path[k].second << ",";
+            if (k == 0) {
+                paths_csv << "START,0,0,0";
+            }
+            else {
+                paths_csv << maneuver_name(t.maneuvers[k]) << "," << t.segment_powers[k - 1] << ","
+                    << t.segment_times[k - 1] << "," << t.segment_fuels[k - 1];
+            }
+            paths_csv << "\n";
+        }
+    }
+    front_csv.close();
+    paths_csv.close();
+
+    ofstream gp_script("plot_pareto.gp");
+    gp_script << "# GNUPLOT script for time/fuel Pareto front\n";
+    gp_script << "set terminal pngcairo size 800,600 enhanced\n";
+    gp_script << "set output 'IL-76_pareto.png'\n\n";
+    gp_script << "set title 'IL-76 - Time/Fuel Pareto Front'\n";
+    gp_script << "set xlabel 'Time (s)'\n";
+    gp_script << "set ylabel 'Fuel (kg)'\n";
+    gp_script << "set grid\n";
+    gp_script << "set datafile separator ','\n";
+    gp_script << "plot 'pareto_front.csv' every ::1 using 2:3 with linespoints \\\n";
+    gp_script << "     lw 2 pt 7 ps 1 title 'Pareto front'\n";
+    gp_script.close();
+
+    cout << "\n=============================================\n";
+    cout << "Samaya bystraya:    " << front.front().total_time << " s, "
+        << front.front().total_fuel << " kg\n";
+    cout << "Samaya ekonomichnaya: " << front.back().total_time << " s, "
+        << front.back().total_fuel << " kg\n";
+    cout << "\nFiles created:\n";
+    cout << "- pareto_front.csv\n";
+    cout << "- pareto_paths.csv\n";
+    cout << "- plot_pareto.gp\n";
+    cout << "=============================================\n";
+}
+
+vector<TrajectoryResult> solve_pareto_front(const SolverOptions& options, const AircraftModel& aircraft,
+    const UniformAtmosphere& atmosphere) {
+    cout << "\n========================================\n";
+    cout << "KRITERII: FRONT PARETO VREMYA/TOPLIVO\n";
+    cout << "========================================\n\n";
+
+    Scenario sc = default_scenario(MIN_TIME, "pareto", aircraft, atmosphere);
+    ParetoWorkspace ws;
+    vector<TrajectoryResult> front = optimize_pareto_front(sc, options, ws);
+    report_pareto_front(front);
+
+    return front;
+}
+
+void report_cost_index_sweep(const vector<double>& ci_values, const vector<TrajectoryResult>& results) {
+    ofstream sweep_csv("cost_index_sweep.csv");
+    sweep_csv << "CI_kg_per_min,Status,Total_time_s,Total_fuel_kg,Total_cost_kg,Razgon,Podiem,Razgon_Podiem\n";
+
+    cout << "Seriya po indeksu stoimosti CI (kg/min):\n";
+    cout << "-------------------------------------------------------------\n";
+    cout << "CI\tVremya (s)\tToplivo (kg)\tStoimost (kg)\n";
+    cout << "-------------------------------------------------------------\n";
+
+    for (size_t k = 0; k < results.size(); k++) {
+        const TrajectoryResult& t = results[k];
+        sweep_csv << ci_values[k] << ",";
+        cout << ci_values[k] << "\t";
+        if (!t.found) {
+            sweep_csv << "no_path,,,,,,\n";
+            cout << "Ne naiden put\n";
+            continue;
+        }
+
+        double cost = t.total_time * ci_values[k] / 60.0 + t.total_fuel;
+        sweep_csv << "ok," << t.total_time << "," << t.total_fuel << "," << cost << ","
+            << t.used_razgon << "," << t.used_podiem << "," << t.used_combined << "\n";
+        cout << setw(8) << t.total_time << "\t" << setw(8) << t.total_fuel << "\t" << setw(8) << cost << "\n";
+    }
+    sweep_csv.close();
+
+    cout << "\nFiles created:\n";
+    cout << "- cost_index_sweep.csv\n";
+}
+
+vector<TrajectoryResult> solve_cost_index_sweep(const vector<double>& ci_values, const SolverOptions& options,
+    const AircraftModel& aircraft, const UniformAtmosphere& atmosphere) {
+    cout << "\n========================================\n";
+    cout << "KRITERII: VREMYA * CI + TOPLIVO\n";
+    cout << "========================================\n\n";
+
+    Scenario sc = default_scenario(MIN_COST, "cost_index", aircraft, atmosphere);
+    SolveWorkspace ws;
+    vector<TrajectoryResult> results = optimize_cost_index_sweep(sc, ci_values, options, ws);
+    report_cost_index_sweep(ci_values, results);
+
+    return results;
+}
+
+// Функция для создания GNUPLOT скриптов
+void create_gnuplot_scripts(const TrajectoryResult& traj_time, const TrajectoryResult& traj_fuel) {
+    cout << "\nCreating GNUPLOT scripts...\n";
+
+    // 1. Скрипт для сравнения траекторий
+    ofstream comp_script("plot_comparison.gp");
+    comp_script << "# GNUPLOT script for trajectory comparison\n";
+    comp_script << "set terminal pngcairo size 1200,800 enhanced font 'Verdana,12'\n";
+    comp_script << "set output 'IL-76_comparison.png'\n\n";
+    comp_script << "set title 'IL-76 Trajectory Comparison (Variant 1)'\n";
+    comp_script << "set xlabel 'Speed V (km/h)'\n";
+    comp_script << "set ylabel 'Altitude H (m)'\n";
+    comp_script << "set grid\n";
+    comp_script << "set key top left\n";
+    comp_script << "set datafile separator ','\n\n";
+    comp_script << "# Plot with lines AND points\n";
+    comp_script << "plot 'trajectory_min_time.csv' using 3:2 every ::1 \\\n";
+    comp_script << "     with linespoints lw 2 pt 7 ps 1.2 lc rgb 'red' \\\n";
+    comp_script << "     title 'Min Time (" << traj_time.total_time / 60.0
+        << " min, " << traj_time.total_fuel << " kg)', \\\n";
+    comp_script << "     'trajectory_min_fuel.csv' using 3:2 every ::1 \\\n";
+    comp_script << "     with linespoints lw 2 pt 7 ps 1.2 lc rgb 'blue' \\\n";
+    comp_script << "     title 'Min Fuel (" << traj_fuel.total_time / 60.0
+        << " min, " << traj_fuel.total_fuel << " kg)'\n\n";
+
+    // 2. Скрипт для отдельных траекторий
+    ofstream time_script("plot_min_time.gp");
+    time_script << "# GNUPLOT script for min time trajectory\n";
+    time_script << "set terminal pngcairo size 800,600 enhanced\n";
+    time_script << "set output 'IL-76_min_time.png'\n\n";
+    time_script << "set title 'IL-76 - Minimize Time'\n";
+    time_script << "set xlabel 'Speed V (km/h)'\n";
+    time_script << "set ylabel 'Altitude H (m)'\n";
+    time_script << "set grid\n";
+    time_script << "set datafile separator ','\n";
+    time_script << "# Plot with points at each vertex\n";
+    time_script << "plot 'trajectory_min_time.csv' using 3:2 every ::1 \\\n";
+    time_script << "     with linespoints lw 2 pt 7 ps 1.5 lc rgb 'red' \\\n";
+    time_script << "     title 'Min Time Trajectory'\n\n";
+    time_script << "# Optionally label maneuvers\n";
+    time_script << "# To add maneuver labels, uncomment below:\n";
+    time_script << "# set label 'Razgon' at first point...\n";
+    time_script.close();
+
+    ofstream fuel_script("plot_min_fuel.gp");
+    fuel_script << "# GNUPLOT script for min fuel trajectory\n";
+    fuel_script << "set terminal pngcairo size 800,600 enhanced\n";
+    fuel_script << "set output 'IL-76_min_fuel.png'\n\n";
+    fuel_script << "set title 'IL-76 - Minimize Fuel'\n";
+    fuel_script << "set xlabel 'Speed V (km/h)'\n";
+    fuel_script << "set ylabel 'Altitude H (m)'\n";
+    fuel_script << "set grid\n";
+    fuel_script << "set datafile separator ','\n";
+    fuel_script << "plot 'trajectory_min_fuel.csv' using 3:2 every ::1 \\\n";
+    fuel_script << "     with linespoints lw 2 pt 7 ps 1.5 lc rgb 'blue' \\\n";
+    fuel_script << "     title 'Min Fuel Trajectory'\n";
+    fuel_script.close();
+
+    // // 4. BAT файл для Windows
+    // ofstream bat_file("run_plots.bat");
+    // bat_file << "@echo off\n";
+    // bat_file << "echo Running GNUPLOT scripts for IL-76...\n";
+    // bat_file << "echo.\n";
+    // bat_file << "echo 1. Comparison plot\n";
+    // bat_file << "\"C:\\Program Files\\gnuplot\\bin\\bin\\gnuplot.exe plot_comparison.gp\n";
+    // bat_file << "echo 2. Min time plot\n";
+    // bat_file << "gnuplot plot_min_time.gp\n";
+    // bat_file << "echo 3. Min fuel plot\n";
+    // bat_file << "gnuplot plot_min_fuel.gp\n";
+    // bat_file << "echo.\n";
+    // bat_file << "echo Plots created:\n";
+    // bat_file << "echo - IL-76_comparison.png\n";
+    // bat_file << "echo - IL-76_min_time.png\n";
+    // bat_file << "echo - IL-76_min_fuel.png\n";
+    // bat_file << "echo.\n";
+    // bat_file << "pause\n";
+    // bat_file.close();
+}
+
+// Пакетный режим: файл заданий CSV, одна строка - один сценарий:
+// name,mass_kg,H_start_m,H_finish_m,V_start_kmh,V_finish_kmh,criterion[,aircraft[,atmosphere[,wind]]]
+// criterion - time, fuel или ci<CI>, aircraft - файл модели самолета,
+// atmosphere и wind - как параметры --atmosphere и --wind.
+// Пустые строки и строки с # пропускаются.
+bool parse_number(const string& text, double& value) {
+    const char* begin = text.c_str();
+    char* end = NULL;
+    value = strtod(begin, &end);
+    if (end == begin) return false;
+    while (*end == ' ' || *end == '\t') end++;
+    return *end == '\0';
+}
+
+// Список значений через запятую, например "0,50,100"
+bool parse_number_list(const string& text, vector<double>& values) {
+    values.clear();
+    stringstream ss(text);
+    string field;
+    while (getline(ss, field, ',')) {
+        double value;
+        if (!parse_number(field, value)) return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+// Файл модели самолета: строки "параметр = значение", # - комментарий.
+// Незаданные параметры остаются как у встроенной модели Ил-76.
+struct AircraftField {
+    const char* key;
+    double AircraftModel::* value;
+};
+
+static const AircraftField AIRCRAFT_FIELDS[] = {
+    { "mass", &AircraftModel::mass },
+    { "wing_area", &AircraftModel::wing_area },
+    { "thrust_percent", &AircraftModel::thrust_percent },
+    { "thrust_sea", &AircraftModel::thrust_sea },
+    { "thrust_lapse", &AircraftModel::thrust_lapse },
+    { "thrust_lapse_power", &AircraftModel::thrust_lapse_power },
+    { "thrust_mach0", &AircraftModel::thrust_mach0 },
+    { "thrust_mach_slope", &AircraftModel::thrust_mach_slope },
+    { "thrust_mach_max", &AircraftModel::thrust_mach_max },
+    { "cy0", &AircraftModel::cy0 },
+    { "cy1", &AircraftModel::cy1 },
+    { "cx0", &AircraftModel::cx0 },
+    { "k_induced", &AircraftModel::k_induced },
+    { "cx_min", &AircraftModel::cx_min },
+    { "alpha_max", &AircraftModel::alpha_max },
+    { "cp_base", &AircraftModel::cp_base },
+    { "sfc_altitude", &AircraftModel::sfc_altitude },
+    { "sfc_mach", &AircraftModel::sfc_mach },
+    { "V_min_kmh", &AircraftModel::V_min_kmh },
+    { "V_max_kmh", &AircraftModel::V_max_kmh },
+    { "H_max", &AircraftModel::H_max },
+    { "M_max", &AircraftModel::M_max }
+};
+const int AIRCRAFT_FIELD_COUNT = sizeof(AIRCRAFT_FIELDS) / sizeof(AIRCRAFT_FIELDS[0]);
+
+string trim_spaces(const string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+bool load_aircraft(const string& path, AircraftModel& ac) {
+    ifstream in(path.c_str());
+    if (!in) {
+        cout << "OSHIBKA: ne udalos otkryt fail modeli samoleta " << path << "\n";
+        return false;
+    }
+
+    ac = il76_d30kp();
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        line_no++;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        line = trim_spaces(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t eq = line.find('=');
+        string key = trim_spaces(line.substr(0, eq));
+        string text = eq == string::npos ? "" : trim_spaces(line.substr(eq + 1));
+        double value = 0.0;
+        bool ok = eq != string::npos;
+
+        if (ok && key == "name") ac.name = text;
+        else if (ok && key == "engine") ac.engine = text;
+        else if (ok && key == "engine_count") {
+            ok = parse_number(text, value) && value >= 1.0;
+            ac.engine_count = (int)value;
+        }
+        else if (ok) {
+            int f = 0;
+            while (f < AIRCRAFT_FIELD_COUNT && key != AIRCRAFT_FIELDS[f].key) f++;
+            ok = f < AIRCRAFT_FIELD_COUNT && parse_number(text, value);
+            if (ok) ac.*AIRCRAFT_FIELDS[f].value = value;
+        }
+
+        if (!ok) {
+            cout << "OSHIBKA v stroke " << line_no << " faila " << path << ": " << line << "\n";
+            return false;
+        }
+    }
+
+    // Таблица атмосферы задана до 11 км
+    if (ac.mass <= 0.0 || ac.wing_area <= 0.0 || ac.thrust_sea <= 0.0 || ac.cy1 <= 0.0 ||
+        ac.H_max <= 0.0 || ac.H_max > 11000.0 || ac.V_max_kmh <= ac.V_min_kmh) {
+        cout << "OSHIBKA: nevernye parametry modeli samoleta v faile " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Модели самолетов пакета: каждый файл загружается один раз,
+// сценарии ссылаются на модели по указателю (deque их не перемещает)
+struct AircraftLibrary {
+    deque<AircraftModel> models;
+    vector<string> paths;
+};
+
+const AircraftModel* find_aircraft(AircraftLibrary& library, const string& path) {
+    for (size_t k = 0; k < library.paths.size(); k++) {
+        if (library.paths[k] == path) return &library.models[k];
+    }
+    AircraftModel ac;
+    if (!load_aircraft(path, ac)) return NULL;
+    library.models.push_back(ac);
+    library.paths.push_back(path);
+    return &library.models.back();
+}
+
+// Атмосфера сценария: "isa", "isa+15", "isa-10" (МСА со сдвигом температуры, K)
+// или файл зондирования со строками "H_m, T_K, p_Pa[, W_ms]". Ветер:
+// "H:W;H:W..." прямо в параметре или файл со строками "H_m, W_ms",
+// W > 0 - встречный. Пустая строка - МСА и безветрие.
+struct AtmosphereSpec {
+    string atmosphere;
+    string wind;
+};
+
+const double GAS_CONSTANT = 287.05287;
+const double MAX_ISA_OFFSET = 60.0;
+// Предел сдвига ветра: сильнее не бывает даже в струйных течениях,
+// а при |V dW/dH| порядка g модель установившегося подъема уже неверна
+const double MAX_WIND_SHEAR = 0.02;
+
+bool parse_isa_spec(const string& spec, double& dT) {
+    if (spec.compare(0, 3, "isa") != 0) return false;
+    dT = 0.0;
+    return spec.size() == 3 || parse_number(spec.substr(3), dT);
+}
+
+// Точка "H<sep>W" профиля ветра
+bool parse_wind_point(const string& text, char sep, pair<double, double>& point) {
+    size_t pos = text.find(sep);
+    return pos != string::npos && parse_number(text.substr(0, pos), point.first) &&
+        parse_number(text.substr(pos + 1), point.second);
+}
+
+bool parse_inline_wind(const string& spec, vector<pair<double, double> >& wind) {
+    wind.clear();
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, ';')) {
+        pair<double, double> point;
+        if (!parse_wind_point(item, ':', point)) return false;
+        wind.push_back(point);
+    }
+    return !wind.empty();
+}
+
+// Строки файла профиля по полям через запятую; первая строка,
+// начинающаяся с буквы, - заголовок
+bool read_profile_rows(const string& path, const char* what, size_t min_fields, size_t max_fields,
+    vector<vector<double> >& rows) {
+    ifstream in(path.c_str());
+    if (!in) {
+        cout << "OSHIBKA: ne udalos otkryt fail " << what << " " << path << "\n";
+        return false;
+    }
+
+    rows.clear();
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        line_no++;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        line = trim_spaces(line);
+        if (line.empty() || line[0] == '#') continue;
+        if (rows.empty() && isalpha((unsigned char)line[0])) continue;
+
+        vector<double> row;
+        stringstream ss(line);
+        string field;
+        double value;
+        bool ok = true;
+        while (ok && getline(ss, field, ',')) {
+            ok = parse_number(field, value);
+            row.push_back(value);
+        }
+        if (!ok || row.size() < min_fields || row.size() > max_fields) {
+            cout << "OSHIBKA v stroke " << line_no << " faila " << path << ": " << line << "\n";
+            return false;
+        }
+        rows.push_back(row);
+    }
+    return true;
+}
+
+bool load_sounding(const string& path, AtmosphereProfile& profile) {
+    vector<vector<double> > rows;
+    if (!read_profile_rows(path, "zondirovaniya", 3, 4, rows)) return false;
+
+    profile.name = path;
+    profile.levels.clear();
+    profile.wind.clear();
+    for (size_t k = 0; k < rows.size(); k++) {
+        const vector<double>& row = rows[k];
+        if (row[1] <= 0.0 || row[2] <= 0.0 || (k > 0 && row[0] <= rows[k - 1][0])) {
+            cout << "OSHIBKA: v faile " << path << " T i p dolzhny byt > 0, a H - vozrastat\n";
+            return false;
+        }
+        AtmosPoint p;
+        p.H = row[0];
+        p.T = row[1];
+        p.rho = row[2] / (GAS_CONSTANT * p.T);
+        p.a = sqrt(1.4 * GAS_CONSTANT * p.T);
+        profile.levels.push_back(p);
+        if (row.size() == 4) profile.wind.push_back(make_pair(row[0], row[3]));
+    }
+    if (profile.levels.size() < 2) {
+        cout << "OSHIBKA: v faile " << path << " menshe dvukh urovnei\n";
+        return false;
+    }
+    if (!profile.wind.empty() && profile.wind.size() != profile.levels.size()) {
+        cout << "OSHIBKA: v faile " << path << " veter zadan ne na vsekh urovnyakh\n";
+        return false;
+    }
+    return true;
+}
+
+bool load_wind(const string& spec, vector<pair<double, double> >& wind) {
+    if (parse_inline_wind(spec, wind)) return true;
+
+    vector<vector<double> > rows;
+    if (!read_profile_rows(spec, "vetra", 2, 2, rows)) return false;
+    wind.clear();
+    for (size_t k = 0; k < rows.size(); k++) {
+        wind.push_back(make_pair(rows[k][0], rows[k][1]));
+    }
+    return true;
+}
+
+bool check_wind(const vector<pair<double, double> >& wind, const string& source) {
+    for (size_t k = 1; k < wind.size(); k++) {
+        double dH = wind[k].first - wind[k - 1].first;
+        if (dH <= 0.0) {
+            cout << "OSHIBKA: vysoty profilya vetra " << source << " dolzhny vozrastat\n";
+            return false;
+        }
+        if (fabs(wind[k].second - wind[k - 1].second) > MAX_WIND_SHEAR * dH) {
+            cout << "OSHIBKA: sdvig vetra " << source << " na " << wind[k - 1].first << ".." << wind[k].first
+                << " m bolshe " << MAX_WIND_SHEAR << " 1/s\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool build_atmosphere_profile(const AtmosphereSpec& spec, AtmosphereProfile& profile) {
+    double dT = 0.0;
+    if (spec.atmosphere.empty() || parse_isa_spec(spec.atmosphere, dT)) {
+        if (fabs(dT) > MAX_ISA_OFFSET) {
+            cout << "OSHIBKA: sdvig temperatury MSA vne +-" << MAX_ISA_OFFSET << " K: " << spec.atmosphere << "\n";
+            return false;
+        }
+        profile = isa_profile(dT);
+    }
+    else if (!load_sounding(spec.atmosphere, profile)) {
+        return false;
+    }
+
+    if (!spec.wind.empty()) {
+        if (!load_wind(spec.wind, profile.wind)) return false;
+        profile.name += " veter " + spec.wind;
+    }
+    return check_wind(profile.wind, profile.name);
+}
+
+bool build_atmosphere(const AtmosphereSpec& spec, UniformAtmosphere& table) {
+    AtmosphereProfile profile;
+    if (!build_atmosphere_profile(spec, profile)) return false;
+    table = compile_atmosphere(profile, atmosphere_step(profile));
+    return true;
+}
+
+// Таблицы атмосферы пакета: каждая строится один раз и дальше только
+// читается потоками; сценарии ссылаются на таблицы по указателю
+struct AtmosphereLibrary {
+    deque<UniformAtmosphere> tables;
+    vector<string> keys;
+};
+
+const UniformAtmosphere* find_atmosphere(AtmosphereLibrary& library, const AtmosphereSpec& spec) {
+    string key = spec.atmosphere + "\n" + spec.wind;
+    for (size_t k = 0; k < library.keys.size(); k++) {
+        if (library.keys[k] == key) return &library.tables[k];
+    }
+    UniformAtmosphere table;
+    if (!build_atmosphere(spec, table)) return NULL;
+    library.tables.push_back(table);
+    library.keys.push_back(key);
+    return &library.tables.back();
+}
+
+// Критерий: time, fuel или ci<CI>
+bool parse_criterion(string crit, Scenario& sc) {
+    crit.erase(remove(crit.begin(), crit.end(), ' '), crit.end());
+    sc.cost_index = 0.0;
+    if (crit == "time" || crit == "1") sc.criterion = MIN_TIME;
+    else if (crit == "fuel" || crit == "2") sc.criterion = MIN_FUEL;
+    else if (crit.compare(0, 2, "ci") == 0 && parse_number(crit.substr(2), sc.cost_index) && sc.cost_index >= 0.0) {
+        sc.criterion = MIN_COST;
+    }
+    else return false;
+    return true;
+}
+
+// Необязательные поля: восьмое - файл модели самолета, девятое и
+// десятое - атмосфера и ветер (AtmosphereSpec)
+bool parse_scenario(const string& line, Scenario& sc, string& aircraft_file, AtmosphereSpec& conditions) {
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (getline(ss, field, ',')) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 7 || fields.size() > 10) return false;
+    fields.resize(10);
+
+    sc.name = fields[0];
+    aircraft_file = trim_spaces(fields[7]);
+    conditions.atmosphere = trim_spaces(fields[8]);
+    conditions.wind = trim_spaces(fields[9]);
+    sc.cost_index = 0.0;
+    if (!parse_number(fields[1], sc.mass) ||
+        !parse_number(fields[2], sc.H_start) || !parse_number(fields[3], sc.H_finish) ||
+        !parse_number(fields[4], sc.V_start_kmh) || !parse_number(fields[5], sc.V_finish_kmh)) {
+        return false;
+    }
+
+    if (!parse_criterion(fields[6], sc)) return false;
+
+    return sc.mass > 0.0 && sc.H_finish > sc.H_start && sc.V_finish_kmh > sc.V_start_kmh;
+}
+
+bool is_absolute_path(const string& path) {
+    return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+}
+
+// Файлы моделей, зондирования и ветра ищутся относительно каталога файла
+// заданий. Пустые поля атмосферы и ветра берутся из defaults.
+bool load_scenarios(const string& path, vector<Scenario>& jobs, const AircraftModel& aircraft,
+    AircraftLibrary& library, AtmosphereLibrary& atmospheres, const AtmosphereSpec& defaults) {
+    size_t slash = path.find_last_of("/\\");
+    string job_dir = slash == string::npos ? "" : path.substr(0, slash + 1);
+
+    ifstream in(path.c_str());
+    if (!in) {
+        cout << "OSHIBKA: ne udalos otkryt fail zadanii " << path << "\n";
+        return false;
+    }
+
+    string line;
+    int line_no = 0;
+    bool header = true;
+    while (getline(in, line)) {
+        line_no++;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#') continue;
+
+        // Первая значимая строка - заголовок
+        if (header) {
+            header = false;
+            if (line.compare(0, 4, "name") == 0) continue;
+        }
+
+        Scenario sc;
+        string aircraft_file;
+        AtmosphereSpec conditions;
+        double dT;
+        vector<pair<double, double> > wind;
+        if (!parse_scenario(line, sc, aircraft_file, conditions)) {
+            cout << "OSHIBKA v stroke " << line_no << ", stroka propushena: " << line << "\n";
+            continue;
+        }
+
+        if (conditions.atmosphere.empty()) conditions.atmosphere = defaults.atmosphere;
+        else if (!parse_isa_spec(conditions.atmosphere, dT) && !is_absolute_path(conditions.atmosphere)) {
+            conditions.atmosphere = job_dir + conditions.atmosphere;
+        }
+        if (conditions.wind.empty()) conditions.wind = defaults.wind;
+        else if (!parse_inline_wind(conditions.wind, wind) && !is_absolute_path(conditions.wind)) {
+            conditions.wind = job_dir + conditions.wind;
+        }
+
+        sc.aircraft = &aircraft;
+        if (!aircraft_file.empty()) {
+            sc.aircraft = find_aircraft(library, is_absolute_path(aircraft_file) ? aircraft_file : job_dir + aircraft_file);
+        }
+        sc.atmosphere = sc.aircraft != NULL ? find_atmosphere(atmospheres, conditions) : NULL;
+        if (sc.aircraft == NULL || sc.atmosphere == NULL) {
+            cout << "Stroka " << line_no << " propushena\n";
+            continue;
+        }
+        jobs.push_back(sc);
+    }
+    return true;
+}
+
+int run_batch(const string& job_file, const string& out_file, SolverOptions options, int thread_count,
+    const AircraftModel& aircraft, AtmosphereLibrary& atmospheres, const AtmosphereSpec& conditions) {
+    vector<Scenario> jobs;
+    AircraftLibrary library;
+    if (!load_scenarios(job_file, jobs, aircraft, library, atmospheres, conditions)) return 1;
+
+    cout << "Paketnyi rezhim: " << jobs.size() << " scenariev, setka " << options.n << " x " << options.n
+        << ", potokov: " << thread_count << "\n";
+
+    // Параллельность - по сценариям, каждый решается одним потоком;
+    // кэш ребер рассчитан на одну сетку и последовательные решения
+    options.pool = NULL;
+    options.edge_cache = NULL;
+
+    vector<TrajectoryResult> results(jobs.size());
+    vector<double> solve_ms(jobs.size(), 0.0);
+    WorkStealingPool pool(thread_count);
+    vector<TrajectoryOptimizer> optimizers;
+    optimizers.reserve(pool.size());
+    for (int worker = 0; worker < pool.size(); worker++) {
+        optimizers.push_back(TrajectoryOptimizer(options.n, options));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    pool.run((int)jobs.size(), [&](int worker, int task) {
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        optimizers[worker].solve(jobs[task], results[task]);
+        solve_ms[task] = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    });
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream out(out_file.c_str());
+    if (!out) {
+        cout << "OSHIBKA: ne udalos sozdat fail " << out_file << "\n";
+        return 1;
+    }
+    out << "name,criterion,aircraft,atmosphere,mass_kg,H_start_m,H_finish_m,V_start_kmh,V_finish_kmh,status,"
+        << "total_time_s,total_fuel_kg,avg_vy_ms,razgon,podiem,razgon_podiem,solve_ms";
+    if (options.refine) {
+        out << ",refined_time_s,refined_fuel_kg,refine_dtime_pct,refine_dfuel_pct,refine_steps,refine_failed";
+    }
+    out << "\n";
+
+    int solved = 0;
+    for (size_t k = 0; k < jobs.size(); k++) {
+        const Scenario& sc = jobs[k];
+        const TrajectoryResult& r = results[k];
+        out << sc.name << "," << criterion_label(sc) << "," << sc.aircraft->name << "," << sc.atmosphere->name << ","
+            << sc.mass << "," << sc.H_start << "," << sc.H_finish << ","
+            << sc.V_start_kmh << "," << sc.V_finish_kmh << ",";
+        if (r.found) {
+            solved++;
+            out << "ok," << r.total_time << "," << r.total_fuel << "," << r.avg_vy << ","
+                << r.used_razgon << "," << r.used_podiem << "," << r.used_combined;
+        }
+        else {
+            out << "no_path,,,,,,";
+        }
+        out << "," << solve_ms[k];
+        if (options.refine && r.found) {
+            out << "," << r.refine.time << "," << r.refine.fuel << ","
+                << 100.0 * (r.total_time - r.refine.time) / r.refine.time << ","
+                << 100.0 * (r.total_fuel - r.refine.fuel) / r.refine.fuel << ","
+                << r.refine.steps << "," << r.refine.failed_segments;
+        }
+        else if (options.refine) {
+            out << ",,,,,,";
+        }
+        out << "\n";
+    }
+    out.close();
+
+    cout << "Resheno: " << solved << " iz " << jobs.size() << " za " << total_s << " s\n";
+    cout << "Rezultaty: " << out_file << "\n";
+    return 0;
+}
+
+// Строка JSON в кавычках
+string json_string(const string& text) {
+    string out = "\"";
+    for (size_t k = 0; k < text.size(); k++) {
+        char c = text[k];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+            out += code;
+        }
+        else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// Время этапов решения без интерфейса, мс
+struct HeadlessTimings {
+    double solve_ms;
+    double refine_ms;
+    double output_ms;
+};
+
+// Путь в JSON: ,"path":{"H_m":[...],"V_kmh":[...],"maneuver":[...],...}
+void write_path_json(ostream& json, const TrajectoryResult& trajectory) {
+    const vector<pair<double, double> >& path = trajectory.path;
+    json << ",\"path\":{\"H_m\":[";
+    for (size_t k = 0; k < path.size(); k++) json << (k ? "," : "") << path[k].first;
+    json << "],\"V_kmh\":[";
+    for (size_t k = 0; k < path.size(); k++) json << (k ? "," : "") << path[k].second;
+    json << "],\"maneuver\":[";
+    for (size_t k = 1; k < path.size(); k++) json << (k > 1 ? "," : "") << "\"" << maneuver_name(trajectory.maneuvers[k]) << "\"";
+    json << "],\"segment_time_s\":[";
+    for (size_t k = 0; k < trajectory.segment_times.size(); k++) json << (k ? "," : "") << trajectory.segment_times[k];
+    json << "],\"segment_fuel_kg\":[";
+    for (size_t k = 0; k < trajectory.segment_fuels.size(); k++) json << (k ? "," : "") << trajectory.segment_fuels[k];
+    json << "]}";
+}
+
+// Итог решения одной строкой JSON: постановка, итоги, уточнение, время этапов и путь
+void write_summary_json(ostream& out, const Scenario& sc, const SolverOptions& options,
+    const TrajectoryResult& trajectory, const HeadlessTimings& timings) {
+    ostringstream json;
+    json << setprecision(10);
+    json << "{\"name\":" << json_string(sc.name)
+        << ",\"aircraft\":" << json_string(sc.aircraft->name)
+        << ",\"atmosphere\":" << json_string(sc.atmosphere->name)
+        << ",\"criterion\":" << json_string(criterion_label(sc))
+        << ",\"grid\":" << options.n
+        << ",\"mass_kg\":" << sc.mass
+        << ",\"status\":" << (trajectory.found ? "\"ok\"" : "\"no_path\"");
+
+    if (trajectory.found) {
+        json << ",\"total_time_s\":" << trajectory.total_time
+            << ",\"total_fuel_kg\":" << trajectory.total_fuel
+            << ",\"cost\":" << trajectory_cost(sc, trajectory)
+            << ",\"avg_vy_ms\":" << trajectory.avg_vy
+            << ",\"maneuvers\":{\"razgon\":" << trajectory.used_razgon
+            << ",\"podiem\":" << trajectory.used_podiem
+            << ",\"razgon_podiem\":" << trajectory.used_combined
+            << ",\"reverse\":" << trajectory.used_reverse << "}";
+
+        const RefineSummary& refine = trajectory.refine;
+        if (refine.done) {
+            json << ",\"refine\":{\"time_s\":" << refine.time
+                << ",\"fuel_kg\":" << refine.fuel
+                << ",\"max_segment_deviation_pct\":" << refine.max_segment_deviation
+                << ",\"steps\":" << refine.steps
+                << ",\"rejected_steps\":" << refine.rejected_steps
+                << ",\"failed_segments\":" << refine.failed_segments << "}";
+        }
+    }
+
+    json << ",\"timings_ms\":{\"solve\":" << timings.solve_ms
+        << ",\"refine\":" << timings.refine_ms
+        << ",\"output\":" << timings.output_ms << "}";
+
+    if (trajectory.found) {
+        write_path_json(json, trajectory);
+    }
+    json << "}\n";
+    out << json.str();
+}
+
+// Решение без меню и без вывода матриц на экран (--headless). job - строка
+// в формате файла заданий пакета или только критерий (time, fuel, ci<CI>)
+// для задачи по умолчанию. На stdout (или в summary_file) выводится одна
+// строка JSON; файлы матриц и траектории пишутся, только если задан --format,
+// таблица всех конечных точек - если задан endpoints_file.
+// Код возврата: 0 - путь найден, 2 - пути нет, 1 - ошибка.
+int run_headless(const string& job, const string& summary_file, const string& endpoints_file, SolverOptions options,
+    int thread_count, const AircraftModel& aircraft, AtmosphereLibrary& atmospheres, const AtmosphereSpec& defaults,
+    bool write_files) {
+    Scenario sc = default_scenario(MIN_TIME, "headless", aircraft, *find_atmosphere(atmospheres, defaults));
+    AircraftLibrary library;
+    bool parsed;
+    if (job.find(',') != string::npos) {
+        string aircraft_file;
+        AtmosphereSpec conditions;
+        parsed = parse_scenario(job, sc, aircraft_file, conditions);
+        if (parsed && !aircraft_file.empty()) {
+            sc.aircraft = find_aircraft(library, aircraft_file);
+            parsed = sc.aircraft != NULL;
+        }
+        if (parsed && (!conditions.atmosphere.empty() || !conditions.wind.empty())) {
+            if (conditions.atmosphere.empty()) conditions.atmosphere = defaults.atmosphere;
+            if (conditions.wind.empty()) conditions.wind = defaults.wind;
+            sc.atmosphere = find_atmosphere(atmospheres, conditions);
+            parsed = sc.atmosphere != NULL;
+        }
+    }
+    else {
+        parsed = parse_criterion(job, sc);
+    }
+    if (!parsed) {
+        cerr << "OSHIBKA: nevernoe zadanie --headless: " << job << "\n";
+        return 1;
+    }
+
+    ThreadPool pool(thread_count);
+    options.pool = &pool;
+    options.quiet = true;
+
+    // Уточнение выполняется отдельно, чтобы измерить его время
+    bool refine = options.refine;
+    options.refine = false;
+
+    HeadlessTimings timings;
+    SolveWorkspace ws;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    TrajectoryResult trajectory = optimize_trajectory(sc, options, ws);
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    if (refine && trajectory.found) {
+        refine_trajectory(sc, ws, trajectory);
+    }
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+    // Отчет с файлами пишет и свои строки на экран - они уходят в stderr
+    if (write_files) {
+        streambuf* console = cout.rdbuf(cerr.rdbuf());
+        report_trajectory(sc, ws, trajectory, options);
+        cout.rdbuf(console);
+    }
+    if (!endpoints_file.empty()) {
+        if (options.mass_aware || !can_trace_any_node(options, ws)) {
+            cerr << "OSHIBKA: tablica konechnykh tochek stroitsya tolko po polnym tablicam DP"
+                << " (bez --stream, --mass-aware, --astar, --c2f)\n";
+            return 1;
+        }
+        if (!write_endpoint_table(endpoints_file, sc, ws)) {
+            cerr << "OSHIBKA: ne udalos zapisat fail " << endpoints_file << "\n";
+            return 1;
+        }
+    }
+    chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+    timings.solve_ms = chrono::duration<double, milli>(t1 - t0).count();
+    timings.refine_ms = chrono::duration<double, milli>(t2 - t1).count();
+    timings.output_ms = chrono::duration<double, milli>(t3 - t2).count();
+
+    if (summary_file.empty()) {
+        write_summary_json(cout, sc, options, trajectory, timings);
+    }
+    else {
+        ofstream out(summary_file.c_str());
+        if (!out) {
+            cerr << "OSHIBKA: ne udalos sozdat fail " << summary_file << "\n";
+            return 1;
+        }
+        write_summary_json(out, sc, options, trajectory, timings);
+    }
+    return trajectory.found ? 0 : 2;
+}
+
+// Пиковый объем резидентной памяти процесса с начала работы, МБ (0 - неизвестен)
+double peak_rss_mb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// Дорожки ядер, которые offer_edge тратит на ребро в (i, j): все режимы
+// набора, в непрерывном режиме - пробы поиска режима (они повторяются
+// здесь же), с таблицей ребер - ни одной
+long long edge_kernel_lanes(const SweepGrid& g, int i, int j, ManeuverType maneuver) {
+    if (g.edges != NULL) return 0;
+    if (!g.physics->continuous) return (long long)g.physics->settings.size();
+
+    long long lanes = 0;
+    SegmentLanes out;
+    with_objective(g, [&](const auto& objective) {
+        search_power(g.physics->settings, objective, [&](const PowerLanes& ps, SegmentLanes& lane_out) {
+            lanes += ps.count;
+            evaluate_edge_power(g, i, j, maneuver, ps, g.mass, lane_out);
+        }, out);
+    });
+    return lanes;
+}
+
+// Число участков, рассчитанных обходом сетки ws.grid: дорожки ядер по всем
+// ребрам с достижимым источником (условия те же, что в relax_cell).
+// Считается отдельным последовательным обходом вне замеров, поэтому ядра
+// и обход счетчика не содержат.
+double count_kernel_lanes(const SolverOptions& options, SolveWorkspace& ws) {
+    const int N = options.n;
+    const SweepGrid& g = ws.grid;
+    DPStore& store = ws.store;
+    store.reset(N, options.streaming);
+
+    long long lanes = 0;
+    with_objective(g, [&](const auto& objective) {
+        for (int i = 0; i <= N; i++) {
+            DPRow cur = store.begin_row(i);
+            DPRow below = row_below(store, i);
+            for (int j = 0; j <= N; j++) {
+                relax_cell(below, cur, g, i, j, objective);
+            }
+            for (int j = 0; j <= N; j++) {
+                if (i > 0 && j > 0 && below.cost[j - 1] < 1e9) lanes += edge_kernel_lanes(g, i, j, RAZGON_PODIEM);
+                if (i > 0 && below.cost[j] < 1e9) lanes += edge_kernel_lanes(g, i, j, PODIEM);
+                if (j > 0 && cur.cost[j - 1] < 1e9) lanes += edge_kernel_lanes(g, i, j, RAZGON);
+            }
+            store.commit_row(i);
+        }
+    });
+    return (double)lanes;
+}
+
+// Среднее время этапов одного решения, мс
+struct BenchPhases {
+    double setup_ms;
+    double relax_ms;
+    double backtrack_ms;
+    double output_ms;
+};
+
+// reps решений сценария на сетке options.n: построение сетки (и подключение
+// кэша ребер), обход, восстановление пути и запись матриц и пути в CSV.
+// false - кэш ребер этой сетки не помещается в EDGE_TABLE_LIMIT.
+bool bench_variant(const Scenario& sc, const SolverOptions& options, SolveWorkspace& ws, EdgeCache* cache,
+    int reps, TrajectoryResult& trajectory, BenchPhases& phases) {
+    BenchPhases total = { 0.0, 0.0, 0.0, 0.0 };
+    for (int r = 0; r < reps; r++) {
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        setup_grid(sc, options.n, ws, options.continuous_power);
+        if (cache != NULL && !attach_edge_cache(*cache, sc, options, ws)) return false;
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+        reset_trajectory(trajectory, sc.name);
+        bool found = false;
+        chrono::steady_clock::time_point t2;
+        with_objective(ws.grid, [&](const auto& objective) {
+            sweep_store(options, ws, NULL, objective);
+            t2 = chrono::steady_clock::now();
+            found = trace_store(ws, options.n, options.n, trajectory, objective);
+        });
+        if (found) finish_trajectory(sc, trajectory);
+        chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+        write_matrix_csv("bench_time_matrix.csv", ws, ws.store.time_matrix());
+        write_matrix_csv("bench_fuel_matrix.csv", ws, ws.store.fuel_matrix());
+        if (found) write_trajectory_csv("bench_trajectory.csv", trajectory);
+        chrono::steady_clock::time_point t4 = chrono::steady_clock::now();
+
+        total.setup_ms += chrono::duration<double, milli>(t1 - t0).count();
+        total.relax_ms += chrono::duration<double, milli>(t2 - t1).count();
+        total.backtrack_ms += chrono::duration<double, milli>(t3 - t2).count();
+        total.output_ms += chrono::duration<double, milli>(t4 - t3).count();
+    }
+
+    phases.setup_ms = total.setup_ms / reps;
+    phases.relax_ms = total.relax_ms / reps;
+    phases.backtrack_ms = total.backtrack_ms / reps;
+    phases.output_ms = total.output_ms / reps;
+    return true;
+}
+
+// Тест производительности: MIN_TIME на сетках sizes в трех вариантах -
+// последовательный обход, волновой обход пулом потоков и последовательный
+// обход с кэшем ребер (кэш строится до замеров). Для малых сеток решение
+// повторяется, время этапов усредняется. Итоги - на экран и в out_file (CSV)
+// для сравнения между версиями.
+int run_bench(const vector<int>& sizes, const string& out_file, SolverOptions options, int thread_count,
+    const AircraftModel& aircraft, const UniformAtmosphere& atmosphere) {
+    const char* variant_names[3] = { "serial", "parallel", "cached" };
+    Scenario sc = default_scenario(MIN_TIME, "bench", aircraft, atmosphere);
+    ThreadPool pool(thread_count);
+    options.streaming = false;
+    options.edge_cache = NULL;
+
+    ofstream out(out_file.c_str());
+    if (!out) {
+        cout << "OSHIBKA: ne udalos sozdat fail " << out_file << "\n";
+        return 1;
+    }
+    out << "n,variant,threads,reps,setup_ms,relax_ms,backtrack_ms,output_ms,cells_per_s,edges_per_s,"
+        << "process_peak_rss_mb,total_time_s\n";
+
+    streamsize precision = cout.precision(3);
+    cout << "Test proizvoditelnosti: " << aircraft.name << ", kriterii time, potokov: " << thread_count << "\n";
+    bool mismatch = false;
+    for (size_t k = 0; k < sizes.size(); k++) {
+        const int N = sizes[k];
+        if (full_store_bytes(N) > FULL_STORE_LIMIT) {
+            cout << "\nSetka " << N << " x " << N << " propushena: polnye tablicy ne pomeshchayutsya v pamyat\n";
+            continue;
+        }
+        double cells = ((double)N + 1.0) * ((double)N + 1.0);
+        int reps = max(1, min(200, (int)(2e6 / cells)));
+        options.n = N;
+
+        SolveWorkspace ws;
+        ws.store.reset(N, false);
+        TrajectoryResult trajectory;
+        EdgeCache cache;
+        double reference_time = 0.0;
+        double edges = 0.0;
+
+        cout << "\nSetka " << N << " x " << N << ", povtorov: " << reps << "\n";
+        cout << setw(10) << "variant" << setw(12) << "setka, ms" << setw(12) << "obkhod, ms" << setw(12) << "put, ms"
+            << setw(12) << "vyvod, ms" << setw(12) << "Muzl/s" << setw(12) << "Mreber/s" << "\n";
+
+        for (int v = 0; v < 3; v++) {
+            options.pool = v == 1 ? &pool : NULL;
+            EdgeCache* variant_cache = NULL;
+            if (v == 2 && options.continuous_power) {
+                cout << setw(10) << variant_names[v] << "  kesh reber ne ispolzuetsya s --continuous-power\n";
+                continue;
+            }
+            if (v == 2) {
+                // Кэш строится один раз, в замеры входит только его подключение
+                chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+                setup_grid(sc, N, ws, options.continuous_power);
+                if (!attach_edge_cache(cache, sc, options, ws)) {
+                    cout << setw(10) << variant_names[v] << "  kesh reber ne pomeshchaetsya v limit "
+                        << EDGE_TABLE_LIMIT / (1024.0 * 1024.0) << " MB\n";
+                    continue;
+                }
+                ws.grid.edges = NULL;
+                cout << setw(10) << "" << "  postroenie kesha reber: "
+                    << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+                variant_cache = &cache;
+            }
+
+            BenchPhases phases;
+            bench_variant(sc, options, ws, variant_cache, reps, trajectory, phases);
+            if (v == 0) {
+                reference_time = trajectory.total_time;
+                edges = count_kernel_lanes(options, ws);
+            }
+            else if (trajectory.total_time != reference_time) {
+                mismatch = true;
+            }
+
+            double cells_per_s = cells / (phases.relax_ms / 1000.0);
+            double edges_per_s = edges / (phases.relax_ms / 1000.0);
+            // Пик процесса с начала работы, а не варианта: включает прежние сетки
+            double rss = peak_rss_mb();
+            cout << setw(10) << variant_names[v] << setw(12) << phases.setup_ms << setw(12) << phases.relax_ms
+                << setw(12) << phases.backtrack_ms << setw(12) << phases.output_ms
+                << setw(12) << cells_per_s / 1e6 << setw(12) << edges_per_s / 1e6 << "\n";
+
+            out << N << "," << variant_names[v] << "," << (v == 1 ? thread_count : 1) << "," << reps << ","
+                << phases.setup_ms << "," << phases.relax_ms << "," << phases.backtrack_ms << ","
+                << phases.output_ms << "," << cells_per_s << "," << edges_per_s << "," << rss << ","
+                << (trajectory.found ? trajectory.total_time : 0.0) << "\n";
+        }
+        cout << "Pik RSS processa s nachala raboty: " << peak_rss_mb() << " MB\n";
+    }
+    out.close();
+    cout.precision(precision);
+
+    remove("bench_time_matrix.csv");
+    remove("bench_fuel_matrix.csv");
+    remove("bench_trajectory.csv");
+
+    if (mismatch) {
+        cout << "\nOSHIBKA: rezultaty variantov razlichayutsya\n";
+        return 1;
+    }
+    cout << "\nRezultaty: " << out_file << "\n";
+    return 0;
+}
+
+// Оценка устойчивости оптимального профиля (--monte-carlo): параметры
+// модели разыгрываются случайно, для каждой выборки считаются время и
+// топливо номинального пути (профиль H, V тот же) и заново оптимальный путь.
+// Разброс - стандартные отклонения множителей массы, тяги, Cx0 и удельного
+// расхода и сдвига температуры атмосферы, K; отклонения нормальные,
+// обрезанные на 3 sigma.
+struct MonteCarloSpread {
+    double mass;
+    double thrust;
+    double cx0;
+    double sfc;
+    double dT;
+};
+
+MonteCarloSpread default_monte_carlo_spread() {
+    MonteCarloSpread spread;
+    spread.mass = 0.02;
+    spread.thrust = 0.03;
+    spread.cx0 = 0.05;
+    spread.sfc = 0.03;
+    spread.dT = 5.0;
+    return spread;
+}
+
+// Поток случайных чисел (splitmix64). Поток у каждого рабочего потока свой
+// и перед каждой выборкой заново инициализируется от (seed, номер выборки),
+// поэтому результат не зависит ни от числа потоков, ни от раздачи выборок.
+struct RandomStream {
+    unsigned long long state;
+
+    void seed(unsigned long long seed, unsigned long long stream) {
+        state = seed;
+        state = next() ^ (stream * 0xD1B54A32D192ED03ULL);
+    }
+
+    unsigned long long next() {
+        unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Равномерное на (0, 1)
+    double uniform() {
+        return ((next() >> 11) + 0.5) / 9007199254740992.0;
+    }
+
+    // Нормальное N(0, 1), обрезанное на +-3 (преобразование Бокса - Мюллера)
+    double normal() {
+        const double two_pi = 2.0 * acos(-1.0);
+        double r = sqrt(-2.0 * log(uniform()));
+        return min(3.0, max(-3.0, r * cos(two_pi * uniform())));
+    }
+};
+
+struct MonteCarloSample {
+    double mass;    // множители параметров модели
+    double thrust;
+    double cx0;
+    double sfc;
+    double dT;      // сдвиг температуры, K
+    bool fixed_valid;
+    double fixed_time;
+    double fixed_fuel;
+    bool found;
+    double time;
+    double fuel;
+};
+
+// Состояние рабочего потока, используется всеми его выборками
+struct MonteCarloWorker {
+    RandomStream random;
+    AircraftModel aircraft;
+    AtmosphereProfile profile;
+    UniformAtmosphere atmosphere;
+    TrajectoryResult trajectory;
+};
+
+// Распределение величины по выборкам; p05, p50, p95 - процентили
+struct Distribution {
+    int count;
+    double mean;
+    double stddev;
+    double min;
+    double p05;
+    double p50;
+    double p95;
+    double max;
+};
+
+double sorted_percentile(const vector<double>& sorted, double q) {
+    double x = q * (sorted.size() - 1);
+    size_t k = min((size_t)x, sorted.size() - 1);
+    if (k + 1 == sorted.size()) return sorted[k];
+    return sorted[k] + (x - k) * (sorted[k + 1] - sorted[k]);
+}
+
+Distribution describe_values(vector<double> values) {
+    Distribution d;
+    d.count = (int)values.size();
+    d.mean = d.stddev = d.min = d.p05 = d.p50 = d.p95 = d.max = 0.0;
+    if (values.empty()) return d;
+
+    sort(values.begin(), values.end());
+    double sum = 0.0, sum_sq = 0.0;
+    for (size_t k = 0; k < values.size(); k++) sum += values[k];
+    d.mean = sum / values.size();
+    for (size_t k = 0; k < values.size(); k++) sum_sq += (values[k] - d.mean) * (values[k] - d.mean);
+    d.stddev = values.size() > 1 ? sqrt(sum_sq / (values.size() - 1)) : 0.0;
+    d.min = values.front();
+    d.p05 = sorted_percentile(values, 0.05);
+    d.p50 = sorted_percentile(values, 0.50);
+    d.p95 = sorted_percentile(values, 0.95);
+    d.max = values.back();
+    return d;
+}
+
+void print_distribution(const string& label, const Distribution& d) {
+    cout << left << setw(28) << label << right << setw(8) << d.count << setw(10) << d.mean << setw(9) << d.stddev
+        << setw(10) << d.min << setw(10) << d.p05 << setw(10) << d.p50 << setw(10) << d.p95 << setw(10) << d.max << "\n";
+}
+
+// Выборки решаются параллельно, каждая одним потоком со своим
+// оптимизатором (рабочая область выделяется один раз на поток).
+// Итоги - на экран, значения по выборкам - в out_file (CSV).
+int run_monte_carlo(int samples, unsigned long long seed, const MonteCarloSpread& spread, const string& criterion,
+    const string& out_file, SolverOptions options, int thread_count, const AircraftModel& aircraft,
+    const AtmosphereSpec& conditions) {
+    AtmosphereProfile nominal_profile;
+    if (!build_atmosphere_profile(conditions, nominal_profile)) return 1;
+    double step = atmosphere_step(nominal_profile);
+    UniformAtmosphere nominal_atmosphere = compile_atmosphere(nominal_profile, step);
+
+    Scenario nominal = default_scenario(MIN_TIME, "monte_carlo", aircraft, nominal_atmosphere);
+    if (!parse_criterion(criterion, nominal)) {
+        cout << "OSHIBKA: nevernyi kriterii --mc-criterion: " << criterion << "\n";
+        return 1;
+    }
+
+    options.pool = NULL;
+    options.edge_cache = NULL;
+    options.refine = false;
+    options.quiet = true;
+
+    WorkStealingPool pool(thread_count);
+    vector<TrajectoryOptimizer> optimizers;
+    optimizers.reserve(pool.size());
+    for (int worker = 0; worker < pool.size(); worker++) {
+        optimizers.push_back(TrajectoryOptimizer(options.n, options));
+    }
+    vector<MonteCarloWorker> workers(pool.size());
+
+    cout << "Monte-Karlo: " << samples << " vyborok, kriterii " << criterion_label(nominal) << ", setka "
+        << options.n << " x " << options.n << ", potokov: " << pool.size() << ", seed " << seed << "\n";
+
+    TrajectoryResult nominal_result = optimizers[0].solve(nominal);
+    vector<pair<int, int> > nodes;
+    if (!nominal_result.found || !path_grid_nodes(optimizers[0].workspace(), nominal_result, nodes)) {
+        cout << "OSHIBKA: nominalnaya zadacha ne imeet resheniya\n";
+        return 1;
+    }
+    cout << "Nominal: vremya " << nominal_result.total_time << " s, toplivo " << nominal_result.total_fuel
+        << " kg, uchastkov " << nodes.size() - 1 << "\n";
+
+    vector<MonteCarloSample> results(samples);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    pool.run(samples, [&](int worker, int task) {
+        MonteCarloWorker& w = workers[worker];
+        MonteCarloSample& r = results[task];
+        w.random.seed(seed, (unsigned long long)task);
+        r.mass = 1.0 + spread.mass * w.random.normal();
+        r.thrust = 1.0 + spread.thrust * w.random.normal();
+        r.cx0 = 1.0 + spread.cx0 * w.random.normal();
+        r.sfc = 1.0 + spread.sfc * w.random.normal();
+        r.dT = spread.dT * w.random.normal();
+
+        w.aircraft = aircraft;
+        w.aircraft.thrust_sea *= r.thrust;
+        w.aircraft.cx0 *= r.cx0;
+        w.aircraft.cp_base *= r.sfc;
+        w.profile.name = nominal_profile.name;
+        w.profile.levels = nominal_profile.levels;
+        w.profile.wind = nominal_profile.wind;
+        shift_temperature(w.profile, r.dT);
+        compile_atmosphere(w.profile, step, w.atmosphere);
+
+        Scenario sc = nominal;
+        sc.aircraft = &w.aircraft;
+        sc.atmosphere = &w.atmosphere;
+        sc.mass = nominal.mass * r.mass;
+
+        r.fixed_valid = optimizers[worker].evaluate(sc, nodes, r.fixed_time, r.fixed_fuel);
+        r.found = optimizers[worker].solve(sc, w.trajectory);
+        r.time = w.trajectory.total_time;
+        r.fuel = w.trajectory.total_fuel;
+    });
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream out(out_file.c_str());
+    if (!out) {
+        cout << "OSHIBKA: ne udalos sozdat fail " << out_file << "\n";
+        return 1;
+    }
+    out << setprecision(10);
+    out << "sample,mass_kg,thrust_factor,cx0_factor,sfc_factor,dT_K,fixed_status,fixed_time_s,fixed_fuel_kg,"
+        << "status,time_s,fuel_kg\n";
+
+    vector<double> fixed_time, fixed_fuel, time, fuel;
+    for (int k = 0; k < samples; k++) {
+        const MonteCarloSample& r = results[k];
+        out << k << "," << nominal.mass * r.mass << "," << r.thrust << "," << r.cx0 << "," << r.sfc << "," << r.dT << ",";
+        if (r.fixed_valid) {
+            out << "ok," << r.fixed_time << "," << r.fixed_fuel << ",";
+            fixed_time.push_back(r.fixed_time);
+            fixed_fuel.push_back(r.fixed_fuel);
+        }
+        else {
+            out << "infeasible,,,";
+        }
+        if (r.found) {
+            out << "ok," << r.time << "," << r.fuel << "\n";
+            time.push_back(r.time);
+            fuel.push_back(r.fuel);
+        }
+        else {
+            out << "no_path,,\n";
+        }
+    }
+    out.close();
+
+    Distribution fixed_time_d = describe_values(fixed_time);
+    Distribution time_d = describe_values(time);
+    cout << "\n" << left << setw(28) << "" << right << setw(8) << "vyborok" << setw(10) << "srednee" << setw(9) << "sko"
+        << setw(10) << "min" << setw(10) << "p5" << setw(10) << "p50" << setw(10) << "p95" << setw(10) << "max" << "\n";
+    print_distribution("Nominalnyi put, vremya s", fixed_time_d);
+    print_distribution("Nominalnyi put, toplivo kg", describe_values(fixed_fuel));
+    print_distribution("Reoptimizaciya, vremya s", time_d);
+    print_distribution("Reoptimizaciya, toplivo kg", describe_values(fuel));
+
+    cout << "\nZapas po vremeni (p95 - nominal): nominalnyi put " << fixed_time_d.p95 - nominal_result.total_time
+        << " s, reoptimizaciya " << time_d.p95 - nominal_result.total_time << " s\n";
+    if (fixed_time_d.count < samples) {
+        cout << "Nominalnyi put nevypolnim v " << samples - fixed_time_d.count << " vyborkakh\n";
+    }
+    cout << "Vremya: " << total_s << " s (" << samples / max(total_s, 1e-9) << " vyborok v sekundu)\n";
+    cout << "Rezultaty: " << out_file << "\n";
+    return 0;
+}
+
+// Запросы к таблице конечных точек: строки "H,V_kmh" из in, на каждую -
+// строка JSON в out (итоги и путь или статус off_grid / no_path)
+int run_endpoint_queries(const string& table_file, istream& in, ostream& out) {
+    EndpointTable table;
+    if (!table.open(table_file)) {
+        cerr << "OSHIBKA: fail " << table_file << " ne yavlyaetsya tablicei konechnykh tochek\n";
+        return 1;
+    }
+
+    TrajectoryResult trajectory;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (trim_spaces(line).empty()) continue;
+
+        vector<double> point;
+        if (!parse_number_list(line, point) || point.size() != 2) {
+            cerr << "OSHIBKA: ozhidaetsya \"H,V\": " << line << "\n";
+            continue;
+        }
+
+        int i, j;
+        ostringstream json;
+        json << setprecision(10) << "{\"H_m\":" << point[0] << ",\"V_kmh\":" << point[1];
+        if (table.query(point[0], point[1], trajectory)) {
+            json << ",\"status\":\"ok\",\"total_time_s\":" << trajectory.total_time
+                << ",\"total_fuel_kg\":" << trajectory.total_fuel
+                << ",\"avg_vy_ms\":" << trajectory.avg_vy;
+            write_path_json(json, trajectory);
+        }
+        else {
+            json << ",\"status\":" << (table.find_node(point[0], point[1], i, j) ? "\"no_path\"" : "\"off_grid\"");
+        }
+        json << "}\n";
+        out << json.str();
+    }
+    return 0;
+}
+
+void print_usage() {
+    cout << "Ispolzovanie: DZ [-n N] [--threads T] [--stream] [--mass-aware] [--pareto-labels K]"
+        << " [--ci CI1,CI2,...] [--edge-cache F] [--c2f N0 [--corridor K] [--c2f-check]] [--astar [--reverse] [--stencil K] [--astar-check]]"
+        << " [--refine] [--continuous-power] [--aircraft F] [--atmosphere A] [--wind W] [--format csv|bin|both] [--quiet] [--headless ZADANIE [--summary F] [--endpoints F]]"
+        << " [--query F]"
+        << " [--batch jobs.csv [--out results.csv]] [--bench [--bench-n N1,N2,...] [--out results.csv]]"
+        << " [--monte-carlo K [--mc-criterion C] [--mc-seed S] [--mc-sigma LIST] [--out results.csv]]\n";
+    cout << "  -n N         razmer setki N x N (1.." << MAX_N << ", po umolchaniyu " << DEFAULT_N << ")\n";
+    cout << "  --threads T  chislo potokov (po umolchaniyu - vse yadra)\n";
+    cout << "  --stream     potokovyi rezhim: dve stroki tablic + 2-bitovye kody puti\n";
+    cout << "  --mass-aware uchet umensheniya massy na sozhzhennoe toplivo\n";
+    cout << "  --mass-bucket KG  shirina korziny massy, kg (po umolchaniyu 50)\n";
+    cout << "  --pareto-labels K  maksimum metok fronta Pareto v uzle (po umolchaniyu " << DEFAULT_PARETO_LABELS << ")\n";
+    cout << "  --ci LIST    znacheniya indeksa stoimosti dlya serii, kg/min (po umolchaniyu 0,25,50,100,200,400)\n";
+    cout << "  --edge-cache F  fail kesha uchastkov reber: zagruzhaetsya pri starte, sokhranyaetsya v konce\n";
+    cout << "  --c2f N0     reshenie ot gruboi setki N0 k tochnoi N v koridore vokrug puti\n";
+    cout << "  --corridor K polushirina koridora, uzlov (po umolchaniyu 4)\n";
+    cout << "  --c2f-check  sravnit s polnym resheniem na setke N\n";
+    cout << "  --astar      poisk A* vmesto obkhoda vsei setki - dlya --reverse i --stencil; bez nikh medlennee obkhoda\n";
+    cout << "  --reverse    razreshit tormozhenie, snizhenie i obmen skorosti na vysotu (tolko s --astar)\n";
+    cout << "  --stencil K  perekhody A* na 1..K uzlov po H i V (po umolchaniyu 1)\n";
+    cout << "  --astar-check  sravnit A* s poiskom bez ocenki (Deikstra) na tekh zhe perekhodakh\n";
+    cout << "  --refine     pereschet puti integrirovaniem RK45 s peremennoi massoi, sravnenie s DP\n";
+    cout << "  --continuous-power  nepreryvnyi rezhim dvigatelei: na kazhdom uchastke luchshii rezhim ishchetsya\n"
+        << "               po reshetke " << POWER_LATTICE_STEPS << " shagov mezhdu krainimi rezhimami nabora (front Pareto - po naboru)\n";
+    cout << "  --aircraft F model samoleta i dvigatelei iz faila (po umolchaniyu IL-76 s D-30KP)\n";
+    cout << "  --atmosphere A  atmosfera: isa, isa+DT, isa-DT (sdvig temperatury MSA, K) ili fail zondirovaniya\n"
+        << "               so strokami \"H_m,T_K,p_Pa[,W_ms]\" (po umolchaniyu isa)\n";
+    cout << "  --wind W     vstrechnyi veter po vysote: \"H:W;H:W...\" ili fail so strokami \"H_m,W_ms\",\n"
+        << "               W < 0 - poputnyi, |dW/dH| <= " << MAX_WIND_SHEAR << " 1/s\n";
+    cout << "  --format F   vyvod matric: csv (po umolchaniyu), bin - dvoichnyi fail solution_*.dzc, both\n";
+    cout << "  --quiet      ne vyvodit matricy i tablicu puti na ekran\n";
+    cout << "  --headless Z reshenie bez menyu: Z - kriterii (time, fuel, ci<CI>) ili stroka zadaniya paketa;\n";
+    cout << "               itog - odna stroka JSON (itogi, put, vremya etapov), kod vozvrata 0/2 - put est/net\n";
+    cout << "  --summary F  zapisat JSON itog v fail F vmesto stdout\n";
+    cout << "  --endpoints F  zapisat tablicu vsekh konechnykh tochek setki (fail .dzc, tolko polnye tablicy DP)\n";
+    cout << "  --query F    otvety po tablice F: stroki \"H,V\" so stdin, na kazhduyu - stroka JSON s putem\n";
+    cout << "  --batch F    paketnyi rezhim: scenarii iz CSV faila F\n";
+    cout << "  --out F      fail rezultatov paketa ili testa (po umolchaniyu batch_results.csv, bench_results.csv)\n";
+    cout << "  --bench      test proizvoditelnosti: etapy resheniya, uzly i rebra v sekundu, pik RSS processa;\n"
+        << "               varianty posledovatelnyi, parallelnyi i s keshem reber\n";
+    cout << "  --bench-n L  razmery setok testa (po umolchaniyu 10,100,1000,5000)\n";
+    cout << "  --monte-carlo K  ocenka ustoichivosti: K sluchainykh vyborok parametrov modeli, dlya kazhdoi -\n"
+        << "               nominalnyi put i novoe reshenie; raspredeleniya vremeni i topliva (fail po umolchaniyu\n"
+        << "               monte_carlo.csv)\n";
+    cout << "  --mc-criterion C  kriterii dlya --monte-carlo: time (po umolchaniyu), fuel, ci<CI>\n";
+    cout << "  --mc-seed S  nachalnoe znachenie generatora (po umolchaniyu 1)\n";
+    cout << "  --mc-sigma L sko: massa, tyaga, Cx0, udelnyi raskhod (doli) i temperatura, K\n"
+        << "               (po umolchaniyu 0.02,0.03,0.05,0.03,5)\n";
+}
+
+int main(int argc, char* argv[]) {
+    cout << fixed << setprecision(2);
+
+#ifdef DZ_COUNTERS
+    // Отчет счетчиков ядер - при любом выходе из main, после остановки пулов
+    struct CounterReport {
+        ostream* out;
+        ~CounterReport() {
+            report_kernel_counters(*out);
+        }
+    } counter_report = { &cout };
+#endif
+
+    SolverOptions options = default_solver_options();
+    int thread_count = max(1, (int)thread::hardware_concurrency());
+    string batch_file;
+    string out_file;
+    bool bench = false;
+    vector<double> bench_sizes;
+    parse_number_list("10,100,1000,5000", bench_sizes);
+    int mc_samples = 0;
+    unsigned long long mc_seed = 1;
+    string mc_criterion = "time";
+    MonteCarloSpread mc_spread = default_monte_carlo_spread();
+    vector<double> ci_values;
+    string edge_cache_file;
+    string aircraft_file;
+    AtmosphereSpec conditions;
+    string headless_job;
+    string summary_file;
+    string endpoints_file;
+    string query_file;
+    bool format_set = false;
+    parse_number_list("0,25,50,100,200,400", ci_values);
+
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if ((arg == "-n" || arg == "--n") && a + 1 < argc) {
+            options.n = atoi(argv[++a]);
+        }
+        else if (arg == "--threads" && a + 1 < argc) {
+            thread_count = atoi(argv[++a]);
+        }
+        else if (arg == "--stream") {
+            options.streaming = true;
+        }
+        else if (arg == "--mass-aware") {
+            options.mass_aware = true;
+        }
+        else if (arg == "--mass-bucket" && a + 1 < argc) {
+            options.mass_bucket_kg = atof(argv[++a]);
+        }
+        else if (arg == "--pareto-labels" && a + 1 < argc) {
+            options.pareto_labels = atoi(argv[++a]);
+        }
+        else if (arg == "--ci" && a + 1 < argc) {
+            if (!parse_number_list(argv[++a], ci_values)) {
+                cout << "OSHIBKA: nevernyi spisok CI: " << argv[a] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--edge-cache" && a + 1 < argc) {
+            edge_cache_file = argv[++a];
+        }
+        else if (arg == "--aircraft" && a + 1 < argc) {
+            aircraft_file = argv[++a];
+        }
+        else if (arg == "--atmosphere" && a + 1 < argc) {
+            conditions.atmosphere = argv[++a];
+        }
+        else if (arg == "--wind" && a + 1 < argc) {
+            conditions.wind = argv[++a];
+        }
+        else if (arg == "--c2f" && a + 1 < argc) {
+            options.coarse_n = atoi(argv[++a]);
+        }
+        else if (arg == "--corridor" && a + 1 < argc) {
+            options.corridor_halfwidth = atoi(argv[++a]);
+        }
+        else if (arg == "--c2f-check") {
+            options.corridor_check = true;
+        }
+        else if (arg == "--astar") {
+            options.best_first = true;
+        }
+        else if (arg == "--astar-check") {
+            options.search_check = true;
+        }
+        else if (arg == "--reverse") {
+            options.allow_reverse = true;
+        }
+        else if (arg == "--stencil" && a + 1 < argc) {
+            options.stencil_reach = atoi(argv[++a]);
+        }
+        else if (arg == "--format" && a + 1 < argc) {
+            string format = argv[++a];
+            format_set = true;
+            if (format == "csv") options.output = OUTPUT_CSV;
+            else if (format == "bin") options.output = OUTPUT_BINARY;
+            else if (format == "both") options.output = OUTPUT_BOTH;
+            else {
+                cout << "OSHIBKA: neizvestnyi format vyvoda: " << format << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--quiet") {
+            options.quiet = true;
+        }
+        else if (arg == "--headless" && a + 1 < argc) {
+            headless_job = argv[++a];
+        }
+        else if (arg == "--summary" && a + 1 < argc) {
+            summary_file = argv[++a];
+        }
+        else if (arg == "--endpoints" && a + 1 < argc) {
+            endpoints_file = argv[++a];
+        }
+        else if (arg == "--query" && a + 1 < argc) {
+            query_file = argv[++a];
+        }
+        else if (arg == "--refine") {
+            options.refine = true;
+        }
+        else if (arg == "--continuous-power") {
+            options.continuous_power = true;
+        }
+        else if (arg == "--batch" && a + 1 < argc) {
+            batch_file = argv[++a];
+        }
+        else if (arg == "--out" && a + 1 < argc) {
+            out_file = argv[++a];
+        }
+        else if (arg == "--bench") {
+            bench = true;
+        }
+        else if (arg == "--bench-n" && a + 1 < argc) {
+            if (!parse_number_list(argv[++a], bench_sizes)) {
+                cout << "OSHIBKA: nevernyi spisok setok: " << argv[a] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--monte-carlo" && a + 1 < argc) {
+            mc_samples = atoi(argv[++a]);
+            if (mc_samples < 1) {
+                cout << "OSHIBKA: chislo vyborok dolzhno byt >= 1\n";
+                return 1;
+            }
+        }
+        else if (arg == "--mc-criterion" && a + 1 < argc) {
+            mc_criterion = argv[++a];
+        }
+        else if (arg == "--mc-seed" && a + 1 < argc) {
+            mc_seed = strtoull(argv[++a], NULL, 10);
+        }
+        else if (arg == "--mc-sigma" && a + 1 < argc) {
+            vector<double> sigma;
+            if (!parse_number_list(argv[++a], sigma) || sigma.size() != 5 ||
+                *min_element(sigma.begin(), sigma.end()) < 0.0 ||
+                *max_element(sigma.begin(), sigma.begin() + 4) > 0.3 || sigma[4] > MAX_ISA_OFFSET / 3.0) {
+                cout << "OSHIBKA: --mc-sigma: pyat znachenii, doli ot 0 do 0.3 i temperatura do "
+                    << MAX_ISA_OFFSET / 3.0 << " K: " << argv[a] << "\n";
+                return 1;
+            }
+            mc_spread.mass = sigma[0];
+            mc_spread.thrust = sigma[1];
+            mc_spread.cx0 = sigma[2];
+            mc_spread.sfc = sigma[3];
+            mc_spread.dT = sigma[4];
+        }
+        else {
+            cout << "Neizvestnyi parametr: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    // Запросы к готовой таблице не требуют ни модели, ни решения
+    if (!query_file.empty()) {
+        return run_endpoint_queries(query_file, cin, cout);
+    }
+
+    AircraftModel aircraft = il76_d30kp();
+    if (!aircraft_file.empty() && !load_aircraft(aircraft_file, aircraft)) {
+        return 1;
+    }
+
+    // Таблицы атмосферы строятся один раз; пакет добавляет в библиотеку
+    // атмосферы своих сценариев
+    AtmosphereLibrary atmospheres;
+    const UniformAtmosphere* atmosphere = find_atmosphere(atmospheres, conditions);
+    if (atmosphere == NULL) {
+        return 1;
+    }
+
+    if (options.n < 1 || options.n > MAX_N || thread_count < 1 || options.pareto_labels < 2) {
+        cout << "OSHIBKA: nevernye parametry setki ili potokov\n";
+        print_usage();
+        return 1;
+    }
+
+    if (options.mass_aware && (options.streaming || options.mass_bucket_kg <= 0.0)) {
+        cout << "OSHIBKA: rezhim s uchetom massy trebuet polnykh tablic i shiriny korziny > 0\n";
+        print_usage();
+        return 1;
+    }
+
+    if (options.coarse_n < 0 || options.corridor_halfwidth < 1 || (options.coarse_n > 0 && options.mass_aware)) {
+        cout << "OSHIBKA: rezhim koridora trebuet N0 >= 1, K >= 1 i ne sovmestim s uchetom massy\n";
+        print_usage();
+        return 1;
+    }
+
+    if (((options.allow_reverse || options.stencil_reach != 1 || options.search_check) && !options.best_first) ||
+        options.stencil_reach < 1 ||
+        (options.best_first && (options.mass_aware || options.coarse_n > 0))) {
+        cout << "OSHIBKA: --reverse, --stencil i --astar-check trebuyut --astar; A* ne sovmestim s uchetom massy i koridorom\n";
+        print_usage();
+        return 1;
+    }
+    if (options.best_first && search_state_bytes(options.n) > 2.0 * 1024.0 * 1024.0 * 1024.0) {
+        cout << "OSHIBKA: sostoyanie poiska A* dlya setki " << options.n << " ne pomeshchaetsya v pamyat\n";
+        return 1;
+    }
+
+    // Полные таблицы больших сеток не помещаются в память
+    if (!options.streaming && full_store_bytes(options.n) > FULL_STORE_LIMIT) {
+        (headless_job.empty() ? cout : cerr) << "Setka " << options.n << " x " << options.n
+            << " slishkom velika dlya polnykh tablic, vklyuchen potokovyi rezhim\n";
+        options.streaming = true;
+    }
+
+    if (!headless_job.empty()) {
+#ifdef DZ_COUNTERS
+        counter_report.out = &cerr;
+#endif
+        EdgeCache headless_cache;
+        if (!edge_cache_file.empty()) {
+            options.edge_cache = &headless_cache;
+            load_edge_cache(headless_cache, edge_cache_file, aircraft);
+        }
+        int code = run_headless(headless_job, summary_file, endpoints_file, options, thread_count, aircraft,
+            atmospheres, conditions, format_set);
+        if (options.edge_cache != NULL && headless_cache.dirty &&
+            !save_edge_cache(headless_cache, edge_cache_file, aircraft)) {
+            cerr << "OSHIBKA: ne udalos sokhranit kesh reber " << edge_cache_file << "\n";
+        }
+        return code;
+    }
+
+    if (!batch_file.empty()) {
+        return run_batch(batch_file, out_file.empty() ? "batch_results.csv" : out_file, options, thread_count,
+            aircraft, atmospheres, conditions);
+    }
+
+    if (mc_samples > 0) {
+        return run_monte_carlo(mc_samples, mc_seed, mc_spread, mc_criterion,
+            out_file.empty() ? "monte_carlo.csv" : out_file, options, thread_count, aircraft, conditions);
+    }
+
+    if (bench) {
+        vector<int> sizes;
+        for (size_t k = 0; k < bench_sizes.size(); k++) {
+            int n = (int)bench_sizes[k];
+            if (n < 1 || n > MAX_N || n != bench_sizes[k]) {
+                cout << "OSHIBKA: razmer setki testa vne 1.." << MAX_N << ": " << bench_sizes[k] << "\n";
+                return 1;
+            }
+            sizes.push_back(n);
+        }
+        return run_bench(sizes, out_file.empty() ? "bench_results.csv" : out_file, options, thread_count, aircraft,
+            *atmosphere);
+    }
+
+    cout << "\n=================================================\n";
+    cout << "   OPTIMIZACIA TRAEKTORII " << aircraft.name << " (Variant 9)\n";
+    cout << "=================================================\n";
+    cout << "Samolyet: " << aircraft.name << " (massa " << aircraft.mass / 1000.0 << " t)\n";
+    cout << "Dvigateli: " << aircraft.engine_count << " x " << aircraft.engine << " (" << aircraft.thrust_percent
+        << "% nominala)\n";
+    cout << "Start: H = " << H_START << " m, V = " << V_START_KMH << " km/h\n";
+    cout << "Finish: H = " << H_FINISH << " m, V = " << V_FINISH_KMH << " km/h\n";
+    if (!conditions.atmosphere.empty() || !conditions.wind.empty()) {
+        cout << "Atmosfera: " << atmosphere->name << "\n";
+    }
+    cout << "Setka: " << options.n << " x " << options.n << " ("
+        << (options.streaming ? "potokovyi rezhim" : "polnye tablicy")
+        << "), potokov: " << thread_count << "\n";
+    if (options.coarse_n > 0 && options.coarse_n < options.n) {
+        cout << "Koridor: ot setki " << options.coarse_n << ", +-" << options.corridor_halfwidth << " uzlov\n";
+    }
+    if (options.best_first) {
+        cout << "Poisk A*" << (options.allow_reverse ? " s obratnymi perekhodami" : "")
+            << ", shablon do " << options.stencil_reach << " uzlov\n";
+    }
+    if (options.mass_aware) {
+        cout << "Massa: umenshaetsya na sozhzhennoe toplivo (korzina " << options.mass_bucket_kg << " kg)\n";
+    }
+    cout << "=================================================\n\n";
+
+    ThreadPool pool(thread_count);
+    options.pool = &pool;
+
+    EdgeCache edge_cache;
+    if (!edge_cache_file.empty()) {
+        options.edge_cache = &edge_cache;
+        if (load_edge_cache(edge_cache, edge_cache_file, aircraft)) {
+            cout << "Kesh reber: " << edge_cache_file << ", rezhimov: " << edge_cache.columns.size() << "\n\n";
+        }
+        else {
+            cout << "Kesh reber: " << edge_cache_file << " ne naiden ili ne podkhodit, budet sozdan\n\n";
+        }
+    }
+
+    int choice;
+    cout << "Vyberte kriterii optimizacii:\n";
+    cout << "1 - Minimizacia vremeni\n";
+    cout << "2 - Minimizacia raskhoda topliva\n";
+    cout << "3 - Sravnit oba kriteriya + GNUPLOT GRAFIKI\n";
+    cout << "4 - Front Pareto vremya/toplivo za odin prokhod\n";
+    cout << "5 - Seriya po indeksu stoimosti: vremya * CI + toplivo\n";
+    cout << "Vash vybor (1, 2, 3, 4 ili 5): ";
+    cin >> choice;
+
+    if (choice == 1) {
+        TrajectoryResult result = solve_trajectory(MIN_TIME, "min_time", options, aircraft, *atmosphere);
+
+        // Создаем простой GNUPLOT скрипт для этой траектории
+        ofstream gp_script("plot_single.gp");
+        gp_script << "# GNUPLOT script for single trajectory\n";
+        gp_script << "set terminal pngcairo size 800,600 enhanced\n";
+        gp_script << "set output 'IL-76_single.png'\n\n";
+        gp_script << "set title 'IL-76 - Minimize Time'\n";
+        gp_script << "set xlabel 'Speed V (km/h)'\n";
+        gp_script << "set ylabel 'Altitude H (m)'\n";
+        gp_script << "set grid\n";
+        gp_script << "set datafile separator ','\n";
+        gp_script << "plot 'trajectory_min_time.csv' every ::1 using 3:2 with linespoints \\\n";
+        gp_script << "     lw 2 pt 7 ps 1 title 'Flight path'\n";
+        gp_script.close();
+
+        cout << "\n========================================\n";
+        cout << "To generate plot, run:\n";
+        cout << "gnuplot plot_single.gp\n";
+        cout << "Output: IL-76_single.png\n";
+        cout << "========================================\n";
+    }
+    else if (choice == 2) {
+        TrajectoryResult result = solve_trajectory(MIN_FUEL, "min_fuel", options, aircraft, *atmosphere);
+
+        ofstream gp_script("plot_single.gp");
+        gp_script << "# GNUPLOT script for single trajectory\n";
+        gp_script << "set terminal pngcairo size 800,600 enhanced\n";
+        gp_script << "set output 'IL-76_single.png'\n\n";
+        gp_script << "set title 'IL-76 - Minimize Fuel'\n";
+        gp_script << "set xlabel 'Speed V (km/h)'\n";
+        gp_script << "set ylabel 'Altitude H (m)'\n";
+        gp_script << "set grid\n";
+        gp_script << "set datafile separator ','\n";
+        gp_script << "plot 'trajectory_min_fuel.csv' every ::1 using 3:2 with linespoints \\\n";
+        gp_script << "     lw 2 pt 7 ps 1 title 'Flight path'\n";
+        gp_script.close();
+
+        cout << "\n========================================\n";
+        cout << "To generate plot, run:\n";
+        cout << "gnuplot plot_single.gp\n";
+        cout << "Output: IL-76_single.png\n";
+        cout << "========================================\n";
+    }
+    else if (choice == 3) {
+        TrajectoryResult traj_time = solve_trajectory(MIN_TIME, "min_time", options, aircraft, *atmosphere);
+        TrajectoryResult traj_fuel = solve_trajectory(MIN_FUEL, "min_fuel", options, aircraft, *atmosphere);
+
+        create_gnuplot_scripts(traj_time, traj_fuel);
+
+        cout << "\n========================================\n";
+        cout << "Attempting to run GNUPLOT scripts...\n";
+
+#ifdef _WIN32
+        if (system("gnuplot --version > nul 2>&1") == 0) {
+            cout << "GNUPLOT found. Running scripts...\n\n";
+            system("run_plots.bat");
+        }
+        else {
+            cout << "GNUPLOT not found in PATH.\n";
+            cout << "Please install GNUPLOT from: http://www.gnuplot.info/\n";
+            cout << "Or run scripts manually:\n";
+            cout << "gnuplot plot_comparison.gp\n";
+            cout << "gnuplot plot_min_time.gp\n";
+            cout << "gnuplot plot_min_fuel.gp\n";
+        }
+#else
+        if (system("which gnuplot > /dev/null 2>&1") == 0) {
+            cout << "GNUPLOT found. Running scripts...\n";
+            system("bash run_plots.sh");
+        }
+        else {
+            cout << "GNUPLOT not found.\n";
+            cout << "Please install it: sudo apt-get install gnuplot (Ubuntu)\n";
+            cout << "Or: brew install gnuplot (Mac)\n";
+        }
+#endif
+        cout << "========================================\n";
+    }
+    else if (choice == 4) {
+        solve_pareto_front(options, aircraft, *atmosphere);
+
+        cout << "\n========================================\n";
+        cout << "To generate plot, run:\n";
+        cout << "gnuplot plot_pareto.gp\n";
+        cout << "Output: IL-76_pareto.png\n";
+        cout << "========================================\n";
+    }
+    else if (choice == 5) {
+        solve_cost_index_sweep(ci_values, options, aircraft, *atmosphere);
+    }
+    else {
+        cout << "\nInvalid choice!\n";
+    }
+
+    if (options.edge_cache != NULL && edge_cache.dirty) {
+        if (save_edge_cache(edge_cache, edge_cache_file, aircraft)) {
+            cout << "\nKesh reber sokhranen: " << edge_cache_file << "\n";
+        }
+        else {
+            cout << "\nOSHIBKA: ne udalos sokhranit kesh reber " << edge_cache_file << "\n";
+        }
+    }
+
+    cout << "\nProgram completed.\n";
+    return 0;
 }
\ No newline at end of file